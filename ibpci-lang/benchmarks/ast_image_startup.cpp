@@ -0,0 +1,80 @@
+// Compares a cold start, which lexes and parses the program and writes its
+// image, with a warm start, which reads the tree back from that image
+// usage: ast_image_startup <file.ib> [megabytes]
+// the file is repeated until the source is about megabytes long (10 by
+// default), each start runs five times and the fastest is reported; build
+// with e.g.
+//   g++ -std=c++17 -O2 -pthread -I../ibpci/include ast_image_startup.cpp \
+//     ../ibpci/src/*.cpp -o ast_image_startup
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "ast_image.hpp"
+#include "parser.hpp"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "usage: ast_image_startup <file.ib> [megabytes]" << std::endl;
+    return 1;
+  }
+  std::ifstream file(argv[1]);
+  if (!file.good()) {
+    std::cout << "File '" << argv[1] << "' does not exist" << std::endl;
+    return 1;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string unit = contents.str() + "\n";
+  std::size_t size = (argc > 2 ? std::atof(argv[2]) : 10) * 1000000;
+  std::string source;
+  while (source.size() < size) source += unit;
+
+  double cold = 0, warm = 0;
+  std::string image;
+  std::size_t nodes = 0;
+  for (int run = 0; run < 5; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t hash = ast::hash_bytes(source);
+    prs::Parser parser(source);
+    ast::Tree *tree = parser.parse();
+    if (tree == nullptr) {
+      std::cout << parser.get_error().message << std::endl;
+      return 1;
+    }
+    image = ast::write_image(*tree, hash);
+    double elapsed = seconds_since(start);
+    if (run == 0 || elapsed < cold) cold = elapsed;
+    nodes = tree->nodes.size();
+    delete tree;
+  }
+  for (int run = 0; run < 5; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    ast::Tree *tree = ast::read_image(image, ast::hash_bytes(source));
+    double elapsed = seconds_since(start);
+    if (tree == nullptr || tree->nodes.size() != nodes) {
+      std::cout << "the image was not read back" << std::endl;
+      return 1;
+    }
+    if (run == 0 || elapsed < warm) warm = elapsed;
+    delete tree;
+  }
+
+  std::cout << source.size() / 1e6 << " MB, " << nodes << " nodes, "
+            << image.size() / 1e6 << " MB image: cold " << cold * 1000
+            << " ms, warm " << warm * 1000 << " ms, x" << cold / warm
+            << std::endl;
+}
@@ -0,0 +1,78 @@
+// Measures how lexing a large source into a token buffer scales with threads
+// usage: lexer_scaling <file.ib> [megabytes] [threads]
+// the file is repeated until the source is about megabytes long (64 by
+// default) and tokenized with 1 up to threads threads (every core by default),
+// three runs each, the fastest is reported together with the speedup over one
+// thread; every buffer is checked against the one lexed on a single thread.
+// build with e.g.
+//   g++ -std=c++17 -O2 -pthread -I../ibpci/include lexer_scaling.cpp \
+//     ../ibpci/src/lexer.cpp ../ibpci/src/token.cpp \
+//     ../ibpci/src/diagnostics.cpp -o lexer_scaling
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "lexer.hpp"
+
+namespace {
+
+bool same(const lxr::Tokens &a, const lxr::Tokens &b) {
+  return a.ids == b.ids && a.num_types == b.num_types &&
+         a.offsets == b.offsets && a.lengths == b.lengths &&
+         a.lines == b.lines && a.values == b.values && a.failed == b.failed;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "usage: lexer_scaling <file.ib> [megabytes] [threads]"
+              << std::endl;
+    return 1;
+  }
+  std::ifstream file(argv[1]);
+  if (!file.good()) {
+    std::cout << "File '" << argv[1] << "' does not exist" << std::endl;
+    return 1;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string unit = contents.str() + "\n";
+  std::size_t size = (argc > 2 ? std::atof(argv[2]) : 64) * 1000000;
+  unsigned threads = argc > 3 ? std::atoi(argv[3])
+                              : std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  std::string source;
+  while (source.size() < size) source += unit;
+
+  lxr::Tokens reference;
+  double single = 0;
+  for (unsigned count = 1; count <= threads; ++count) {
+    double best = 0;
+    lxr::Tokens tokens;
+    for (int run = 0; run < 3; ++run) {
+      tokens = lxr::Tokens();
+      auto start = std::chrono::steady_clock::now();
+      lxr::Lexer(source).tokenize(tokens, count);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (run == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    if (count == 1) {
+      reference = std::move(tokens);
+      single = best;
+    } else if (!same(tokens, reference)) {
+      std::cout << count << " threads: tokens differ from one thread"
+                << std::endl;
+      return 1;
+    }
+    std::cout << count << " threads: " << source.size() / 1e6 << " MB, "
+              << reference.size() << " tokens in " << best * 1000
+              << " ms: " << source.size() / 1e6 / best << " MB/s, x"
+              << single / best << std::endl;
+  }
+}
@@ -0,0 +1,50 @@
+// Measures how fast the lexer turns source into tokens
+// usage: lexer_throughput <file.ib> [megabytes]
+// the file is repeated until the source is about megabytes long (10 by
+// default) and lexed five times, the fastest run is reported; build with e.g.
+//   g++ -std=c++17 -O2 -I../ibpci/include lexer_throughput.cpp \
+//     ../ibpci/src/lexer.cpp ../ibpci/src/token.cpp \
+//     ../ibpci/src/diagnostics.cpp -o lexer_throughput
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "lexer.hpp"
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "usage: lexer_throughput <file.ib> [megabytes]" << std::endl;
+    return 1;
+  }
+  std::ifstream file(argv[1]);
+  if (!file.good()) {
+    std::cout << "File '" << argv[1] << "' does not exist" << std::endl;
+    return 1;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string unit = contents.str() + "\n";
+  std::size_t size = (argc > 2 ? std::atof(argv[2]) : 10) * 1000000;
+  std::string source;
+  while (source.size() < size) source += unit;
+
+  double best = 0;
+  long tokens = 0;
+  for (int run = 0; run < 5; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    lxr::Lexer lex(source);
+    tk::Span span;
+    tokens = 0;
+    while (lex.next_span(span) && span.id != tk::END_FILE) ++tokens;
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (run == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+
+  std::cout << source.size() / 1e6 << " MB, " << tokens << " tokens in "
+            << best * 1000 << " ms: " << source.size() / 1e6 / best
+            << " MB/s, " << tokens / 1e6 / best << " M tokens/s" << std::endl;
+}
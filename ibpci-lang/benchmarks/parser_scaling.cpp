@@ -0,0 +1,100 @@
+// Measures how parsing a large program with many methods scales with threads
+// usage: parser_scaling <file.ib> [megabytes] [threads]
+// the file is repeated until the source is about megabytes long (16 by
+// default), lexed once and parsed with 1 up to threads threads (every core by
+// default), three runs each, the fastest is reported together with the
+// speedup over one thread; every tree is checked against the one parsed on a
+// single thread. Only the bodies of methods are parsed on threads, so the
+// file should declare methods. build with e.g.
+//   g++ -std=c++17 -O2 -pthread -I../ibpci/include parser_scaling.cpp \
+//     ../ibpci/src/*.cpp -o parser_scaling
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "parser.hpp"
+
+namespace {
+
+// the same tree, whatever order the nodes are stored in
+bool same(const ast::Tree &a, ast::node x, const ast::Tree &b, ast::node y) {
+  if (x == ast::NONE || y == ast::NONE) return x == y;
+  const ast::Node &m = a[x], &n = b[y];
+  if (m.id != n.id || m.token != n.token || m.num_type != n.num_type ||
+      m.is_terminal != n.is_terminal || m.line != n.line || m.count != n.count)
+    return false;
+  if (m.is_terminal && m.token == tk::NUM && a.num(x) != b.num(y))
+    return false;
+  if (m.is_terminal && m.token != tk::NUM &&
+      (m.token < tk::PLUS || m.token > tk::COMMA) && a.str(x) != b.str(y))
+    return false;
+  for (std::uint32_t i = 0; i < m.count; ++i)
+    if (!same(a, a.child(x, i), b, b.child(y, i))) return false;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "usage: parser_scaling <file.ib> [megabytes] [threads]"
+              << std::endl;
+    return 1;
+  }
+  std::ifstream file(argv[1]);
+  if (!file.good()) {
+    std::cout << "File '" << argv[1] << "' does not exist" << std::endl;
+    return 1;
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string unit = contents.str() + "\n";
+  std::size_t size = (argc > 2 ? std::atof(argv[2]) : 16) * 1000000;
+  unsigned threads = argc > 3 ? std::atoi(argv[3])
+                              : std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  std::string source;
+  while (source.size() < size) source += unit;
+  lxr::Tokens tokens;
+  lxr::Lexer(source).tokenize(tokens);
+
+  ast::Tree *reference = nullptr;
+  double single = 0;
+  for (unsigned count = 1; count <= threads; ++count) {
+    double best = 0;
+    ast::Tree *tree = nullptr;
+    for (int run = 0; run < 3; ++run) {
+      delete tree;
+      auto start = std::chrono::steady_clock::now();
+      prs::Parser parser(source, tokens);
+      tree = parser.parse(count);
+      std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (tree == nullptr) {
+        std::cout << parser.get_error().message << std::endl;
+        return 1;
+      }
+      if (run == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    if (count == 1) {
+      reference = tree;
+      single = best;
+    } else {
+      bool differ = !same(*tree, tree->root, *reference, reference->root);
+      delete tree;
+      if (differ) {
+        std::cout << count << " threads: tree differs from one thread"
+                  << std::endl;
+        return 1;
+      }
+    }
+    std::cout << count << " threads: " << source.size() / 1e6 << " MB, "
+              << reference->nodes.size() << " nodes in " << best * 1000
+              << " ms, x" << single / best << std::endl;
+  }
+  delete reference;
+}
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Times every benchmark program on each execution engine, unoptimized and at
+# -O2
+# usage: run.sh [path to interpreter]
+# build the interpreter with optimizations and without sanitizers first, e.g.
+#   make -C ../ibpci CXXFLAGS="-std=c++17 -O2 -Iinclude" libibpci.a
+#   make -C ../interpreter CXXFLAGS="-std=c++17 -O2" INCLUDE_DIRS=-Iinclude
+
+INTERPRETER=${1:-../interpreter/interpreter}
+BENCHMARKS=$(dirname "$0")
+ENGINES="ast vm closure"
+LEVELS="-O0 -O2"
+TIMEFORMAT="%R"
+
+for file in "$BENCHMARKS"/*.ib; do
+  for engine in $ENGINES; do
+    for level in $LEVELS; do
+      seconds=$({ time "$INTERPRETER" --engine=$engine $level "$file" \
+        >/dev/null; } 2>&1)
+      printf "%-24s %-6s %-3s %ss\n" "$(basename "$file")" "$engine" "$level" \
+        "$seconds"
+    done
+  done
+done
@@ -1,6 +1,7 @@
 #ifndef TEXT_BUFFERS_HPP
 #define TEXT_BUFFERS_HPP
 
+#include <error.hpp>
 #include <memory>
 #include <parser.hpp>
 #include <string>
@@ -13,12 +14,17 @@
 class TextBuffers {
   std::unique_ptr<Trie::Node> text_trie;
   std::string text_buffer;
+  // text_buffer lexed once per update
+  lxr::Tokens tokens;
 
  public:
   TextBuffers();
   bool insert_new_token(std::string token);
   bool delete_token(std::string token);
   bool update_text_buffer(std::string text);
+  // every syntax error in the buffer, found in one pass
+  std::vector<Error> parse_errors();
+  // their messages a line each, empty when there are none
   std::string run_parser();
   std::vector<std::string> get_suggestions(std::string prefix);
 };
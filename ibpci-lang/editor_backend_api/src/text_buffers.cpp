@@ -3,8 +3,9 @@
 TextBuffers::TextBuffers() {
   text_trie = std::make_unique<Trie::Node>();
   for (auto &keyword : tk::RESERVED_KEYWORDS) {
-    Trie::insert_node(text_trie.get(), keyword.first);
+    Trie::insert_node(text_trie.get(), std::string(keyword.lexeme));
   }
+  update_text_buffer("");
 }
 
 bool TextBuffers::insert_new_token(std::string token) {
@@ -17,17 +18,25 @@ bool TextBuffers::delete_token(std::string token) {
 
 bool TextBuffers::update_text_buffer(std::string text) {
   text_buffer = text;
+  tokens = lxr::Tokens();
+  lxr::Lexer(text_buffer).tokenize(tokens);
   return true;
 }
 
+std::vector<Error> TextBuffers::parse_errors() {
+  prs::Parser parser(text_buffer, tokens);
+  parser.recover_errors();
+  delete parser.parse();
+  return parser.get_errors();
+}
+
 std::string TextBuffers::run_parser() {
-  prs::Parser parser(text_buffer);
-  ast::AST *ast = parser.parse();
-  if (ast == nullptr) {
-    return parser.get_error().message;
+  std::string out;
+  for (auto &error : parse_errors()) {
+    if (!out.empty()) out += "\n";
+    out += error.message;
   }
-  ast::delete_tree(ast);
-  return "dupa";
+  return out;
 }
 
 std::vector<std::string> TextBuffers::get_suggestions(std::string prefix) {
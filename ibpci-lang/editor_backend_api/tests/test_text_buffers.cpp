@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include "../include/text_buffers.hpp"
+
+TEST(TextBuffersParser, NoErrors) {
+  TextBuffers buffers;
+  buffers.update_text_buffer("A = 10\noutput(A)\n");
+  EXPECT_TRUE(buffers.parse_errors().empty());
+  EXPECT_EQ(buffers.run_parser(), "");
+}
+
+TEST(TextBuffersParser, EveryStatementWithAnError) {
+  TextBuffers buffers;
+  buffers.update_text_buffer(
+      "A = 10 +\n"
+      "if A > then\n"
+      "  output(A)\n"
+      "end if\n"
+      "method m(X)\n"
+      "  Y = )\n"
+      "  return Y\n"
+      "end method\n"
+      "B = 1\n"
+      "output(B\n");
+  std::vector<Error> errors = buffers.parse_errors();
+  ASSERT_EQ(errors.size(), 4u);
+  EXPECT_EQ(errors[0].line_num, 2u);
+  EXPECT_EQ(errors[1].line_num, 2u);
+  EXPECT_EQ(errors[2].line_num, 6u);
+  EXPECT_EQ(errors[3].line_num, 11u);
+}
+
+TEST(TextBuffersParser, UnclosedBlockStopsAtTheEnclosingEnd) {
+  TextBuffers buffers;
+  buffers.update_text_buffer(
+      "method m(X)\n"
+      "  loop while X > 0\n"
+      "    X = X - 1\n"
+      "end method\n"
+      "Y = (\n");
+  std::vector<Error> errors = buffers.parse_errors();
+  ASSERT_EQ(errors.size(), 2u);
+  EXPECT_EQ(errors[0].line_num, 4u);
+  EXPECT_EQ(errors[1].line_num, 6u);
+}
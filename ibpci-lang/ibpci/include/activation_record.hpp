@@ -3,33 +3,33 @@
 
 #include <iostream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "ast.hpp"
-#include "reference.hpp"
+#include "resolver.hpp"
 #include "token.hpp"
+#include "value.hpp"
 
 namespace ar {
 
-typedef std::unordered_map<std::string, std::unique_ptr<rf::Reference>> data;
+// indexed by the slots rsv::Resolver gave the variables of the scope
+typedef std::vector<val::Value> data;
 
 class AR {
  private:
-  ast::AST *root;
+  ast::node root;
+  const rsv::Scope *scope;
   data contents;
-  std::string name;
 
  public:
-  AR(std::string name, ast::AST *root);
-  void error_uref(std::string key, ast::AST *leaf);
-  void error_itp(std::string key, int type, ast::AST *leaf);
-  void insert(std::string key, rf::Reference *terminal);
-  void insert(std::string key, ast::AST *root);
-  void insert(std::string key, tk::Token *terminal);
-  void mutate_array(std::string key, unsigned address, rf::Reference *terminal);
-  rf::Reference *lookup(std::string key, ast::AST *leaf);
-  ast::AST *lookup_root();
+  AR(const rsv::Scope *scope, ast::node root);
+  void grow();
+  void error_uref(unsigned slot, unsigned line);
+  void error_itp(std::string key, int type, unsigned line);
+  void insert(unsigned slot, val::Value value);
+  void mutate_array(unsigned slot, unsigned address, val::Value value);
+  val::Value &lookup(unsigned slot, unsigned line);
+  ast::node lookup_root();
   std::string lookup_name();
   void print();
 };
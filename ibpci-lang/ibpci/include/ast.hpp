@@ -1,6 +1,8 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include <cstdint>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -40,25 +42,95 @@ enum ast_id {
   STD_RETURN,
   STD_VOID,
   INPUT,
-  OUTPUT
+  OUTPUT,
+  // a statement the parser could not make sense of
+  ERROR,
+  // BINOP and CMP on operands ty::Typer proved to be numbers, or strings;
+  // they are never written to an image
+  NUM_BINOP,
+  STR_CONCAT,
+  NUM_CMP,
+  STR_CMP
 };
 
-class AST {
- public:
-  int id;
-  tk::Token token;
+// index of a node in its Tree
+typedef std::uint32_t node;
+
+const node NONE = UINT32_MAX;
+
+// fixed size node, the strings and numbers of the token it was made from live
+// in the pools of its Tree
+struct Node {
+  std::uint8_t id;
+  // tk::id of the token, num_type tells integer NUM tokens apart
+  std::uint8_t token;
+  std::uint8_t num_type;
   bool is_terminal;
-  std::string non_terminal;
-  std::vector<AST *> children;
-  AST(tk::Token &token, int node_id);
-  AST(int node_id);
-  AST() = default;
-  void push_child(AST *child);
+  // the line of a non-terminal is the line of its first terminal descendant
+  unsigned line;
+  // the children are Tree::kids[first, first + count)
+  std::uint32_t first;
+  std::uint32_t count;
+  // index into Tree::numbers for NUM tokens, into Tree::strings otherwise
+  std::uint32_t payload;
+  // filled in by rsv::Resolver
+  int slot;
+};
+
+// the children of a node, read from the kids of the tree by index so that
+// they can be gone through while the tree grows, as it does when the body of
+// a method is parsed on its first call
+struct Children {
+  struct iterator {
+    const std::vector<node> *kids;
+    std::uint32_t i;
+    node operator*() const { return (*kids)[i]; }
+    iterator &operator++() {
+      ++i;
+      return *this;
+    }
+    bool operator!=(const iterator &other) const { return i != other.i; }
+  };
+
+  const std::vector<node> *kids;
+  std::uint32_t first;
+  std::uint32_t count;
+  iterator begin() const { return {kids, first}; }
+  iterator end() const { return {kids, first + count}; }
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  node operator[](std::size_t i) const { return (*kids)[first + i]; }
+  node back() const { return (*kids)[first + count - 1]; }
 };
 
-void print_tree(AST *root, int offset);
+// The whole tree lives in a handful of flat buffers: nodes are referenced by
+// their index, the children of a node are a range of kids and the token
+// payloads are pooled, strings are stored once per distinct value. The
+// strings never move, so they can be referred to while the tree grows.
+class Tree {
+ public:
+  std::vector<Node> nodes;
+  std::vector<node> kids;
+  std::vector<double> numbers;
+  std::deque<std::string> strings;
+  node root{NONE};
+
+  Node &operator[](node n) { return nodes[n]; }
+  const Node &operator[](node n) const { return nodes[n]; }
+  Children children(node n) const {
+    return {&kids, nodes[n].first, nodes[n].count};
+  }
+  node child(node n, unsigned i) const { return kids[nodes[n].first + i]; }
+  const std::string &str(node n) const { return strings[nodes[n].payload]; }
+  double num(node n) const { return numbers[nodes[n].payload]; }
+  tk::Token token(node n) const;
+
+  node add(int id);
+  node add(int id, const tk::Span &token, std::uint32_t payload);
+  void close(node n, const node *children, std::uint32_t count);
+};
 
-void delete_tree(AST *root);
+void print_tree(const Tree &tree, node root, int offset);
 
 std::string id_to_str(int id);
 
@@ -0,0 +1,48 @@
+#ifndef AST_IMAGE_HPP
+#define AST_IMAGE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "ast.hpp"
+
+namespace ast {
+
+// bumped whenever Node, the node ids or the layout below change
+const std::uint32_t IMAGE_VERSION = 2;
+
+// An image is a parsed Tree as it lies in memory: a header, then the nodes,
+// the kids and the numbers as raw arrays, then the length of every string
+// followed by all of their characters. The header names the source the tree
+// was parsed from by its hash and carries a checksum of the rest.
+struct ImageHeader {
+  char magic[4];
+  std::uint32_t version;
+  // sizeof(Node) and a known word as written, images from a different
+  // layout or byte order are not read
+  std::uint32_t node_size;
+  std::uint32_t byte_order;
+  std::uint64_t source_hash;
+  std::uint64_t checksum;
+  std::uint32_t root;
+  std::uint32_t nodes;
+  std::uint32_t kids;
+  std::uint32_t numbers;
+  std::uint32_t strings;
+  std::uint32_t string_bytes;
+};
+
+// 64-bit FNV-1a over 8 byte words, then over the bytes left
+std::uint64_t hash_bytes(std::string_view bytes);
+
+std::string write_image(const Tree &tree, std::uint64_t source_hash);
+
+// the tree of an image of the source with source_hash, nullptr when the image
+// is for another source, from another version or damaged in any way
+Tree *read_image(std::string_view image, std::uint64_t source_hash);
+
+}  // namespace ast
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "value.hpp"
+
+namespace bc {
+
+enum opcode : std::uint8_t {
+  CONST,          // push constants[a]
+  LOAD,           // push slot a
+  STORE,          // pop into slot a
+  LOAD_ELEM,      // pop b indices, push element of the array in slot a
+  STORE_ELEM,     // pop b indices and a value, store it in array in slot a
+  DISCARD,        // pop and drop
+  ADD,
+  SUB,
+  MUL,
+  DIV,            // '/'
+  DIV_INT,        // 'div'
+  MOD,
+  NEG,
+  LT,
+  GT,
+  LEQ,
+  GEQ,
+  DNEQ,
+  IS,
+  JUMP,           // jump to a
+  JUMP_IF_FALSE,  // pop, jump to a if zero
+  JUMP_IF_TRUE,   // pop, jump to a if not zero
+  FOR_INIT,       // pop bounds into hidden slots a, a + 1, a + 2
+  FOR_ITER,       // copy loop counter from hidden slot a into slot b
+  FOR_NEXT,       // step the counter in hidden slot a, jump to b if in range
+  DECLARE,        // bind method a to its name
+  CALL,           // call method named a with b arguments
+  RETURN,         // return popped value
+  RETURN_VOID,
+  NEW_ARR,        // pop a dimensions, push zeroed array
+  MAKE_ARR,       // pop b elements, push array of shape shapes[a]
+  NEW_STACK,
+  NEW_QUEUE,
+  PUSH,           // pop value, push it onto the stack in slot a
+  ENQUEUE,        // pop value, enqueue it into the queue in slot a
+  LENGTH,         // push length of slot a
+  POP,            // push value popped off the stack in slot a
+  DEQUEUE,        // push value dequeued from the queue in slot a
+  GET_NEXT,
+  HAS_NEXT,
+  IS_EMPTY,
+  PRINT,          // pop and print
+  PRINT_NL,
+  INPUT,          // print prompt strings[a], push lexed user input
+  ERROR,          // raise error strings[a], b is one of error_kind
+  HALT
+};
+
+enum error_kind { SEMANTIC_ERROR, RUNTIME_ERROR };
+
+struct Instr {
+  opcode op;
+  std::int32_t a;
+  std::int32_t b;
+};
+
+class Chunk {
+ public:
+  std::string name;
+  std::vector<Instr> code;
+  std::vector<unsigned> lines;
+  // slot names, parameters come first
+  std::vector<std::string> locals;
+  unsigned params{0};
+  unsigned max_stack{0};
+  unsigned name_id{0};
+};
+
+class Program {
+ public:
+  Chunk main;
+  std::vector<Chunk> methods;
+  std::vector<std::string> method_names;
+  std::vector<val::Value> constants;
+  std::vector<std::string> strings;
+  std::vector<std::vector<unsigned>> shapes;
+};
+
+std::string op_to_str(int op);
+
+void print_program(Program &program);
+
+}  // namespace bc
+
+#endif
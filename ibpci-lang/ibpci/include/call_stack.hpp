@@ -20,17 +20,17 @@ class CallStack {
 
  public:
   void pop();
-  void push_AR(std::string name, ast::AST *root);
-  void push(std::string key, tk::Token *terminal);
-  void push(std::string key, rf::Reference *terminal);
-  void push(std::string key, unsigned address, rf::Reference *terminal);
-  ast::AST *peek_for_root();
+  void push_AR(const rsv::Scope *scope, ast::node root);
+  void grow();
+  void push(unsigned slot, val::Value value);
+  void push(unsigned slot, unsigned address, val::Value value);
+  ast::node peek_for_root();
   std::string peek_for_name();
-  rf::Reference *peek(std::string key, ast::AST *leaf);
+  val::Value &peek(unsigned slot, unsigned line);
   bool empty();
   void test();
   void print(bool entering);
-  CallStack(ast::AST *tree, bool log);
+  CallStack(ast::node root, const rsv::Scope *scope, bool log);
   CallStack() = default;
 };
 
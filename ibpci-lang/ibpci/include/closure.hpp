@@ -0,0 +1,126 @@
+#ifndef CLOSURE_HPP
+#define CLOSURE_HPP
+
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+#include "call_stack.hpp"
+#include "diagnostics.hpp"
+#include "lexer.hpp"
+#include "resolver.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+namespace IBPCI {
+
+// Runs a program the way Interpreter does, on closures built from the tree
+// once before it starts: every node becomes a function that already knows
+// what kind of node it is, which operator it applies and where its operands
+// come from, literals and variables are read in place. Errors are reported
+// at the lines of the nodes they were built from. The values and the call
+// stack are the ones Interpreter uses.
+class ClosureEngine {
+ public:
+  typedef std::function<val::Value()> expr;
+  typedef std::function<bool()> cond;
+  typedef std::function<void()> stmt;
+
+ private:
+  // the statements of a block up to its return, which ends the block
+  struct Block {
+    std::vector<stmt> stmts;
+    expr ret;
+  };
+
+  struct Method {
+    ast::node root;
+    const rsv::Scope *scope;
+    bool has_params;
+    std::vector<unsigned> params;
+    Block body;
+  };
+
+  // operands read without evaluating a subtree
+  struct Constant {
+    val::Value value;
+    const val::Value &operator()(ClosureEngine *) const { return value; }
+  };
+  struct Variable {
+    unsigned slot;
+    unsigned line;
+    const val::Value &operator()(ClosureEngine *engine) const {
+      return engine->call_stack.peek(slot, line);
+    }
+  };
+  struct Computed {
+    expr value;
+    val::Value operator()(ClosureEngine *) const { return value(); }
+  };
+
+  cstk::CallStack call_stack;
+  ast::Tree &tree;
+  rsv::scopes &scopes;
+  std::vector<stmt> main;
+  // the methods never move, the closures that call them point at them
+  std::deque<Method> methods;
+  std::map<std::string, unsigned> method_ids;
+  // the method each name is bound to, nullptr until it is declared
+  std::vector<const Method *> declared;
+
+  void error(std::string message, unsigned line);
+  void error_rt(std::string message, unsigned line);
+  unsigned method_id(const std::string &name);
+  val::Value run(const Block &block);
+
+  stmt statement(ast::node root);
+  Block block(ast::node root);
+  stmt method_decl(ast::node root);
+  stmt exec_if(ast::node root);
+  stmt exec_whl(ast::node root);
+  stmt exec_for(ast::node root);
+  stmt assign(ast::node root);
+  stmt std_void(ast::node root);
+  stmt output(ast::node root);
+  stmt unexpected(ast::node root);
+  expr compute(ast::node root);
+  expr method_call(ast::node root);
+  expr negative(ast::node root);
+  expr make_array(ast::node root);
+  bool get_contents(ast::node root, std::vector<unsigned> &dims,
+                    unsigned nesting, std::vector<ast::node> &elements,
+                    std::string &message, ast::node &at);
+  expr declare_empty_array(ast::node root);
+  expr access_array(ast::node root);
+  expr std_return(ast::node root);
+  expr input(ast::node root);
+  cond condition(ast::node root);
+
+  template <typename F>
+  auto with_operand(ast::node root, F make);
+  template <int op>
+  expr binop(ast::node root);
+  template <int op>
+  cond comparison(ast::node root);
+  template <int op>
+  val::Value arith(const val::Value &l, const val::Value &r, unsigned line);
+  template <int op>
+  bool compare(const val::Value &l, const val::Value &r, unsigned line);
+  val::Array *lookup_array(unsigned slot, unsigned line,
+                           const std::string &name);
+  unsigned compute_key(const val::Array *arr, const val::Value *keys,
+                       unsigned count, unsigned line);
+
+ public:
+  ClosureEngine(ast::Tree &tree, rsv::scopes &scopes);
+  void run();
+};
+
+}  // namespace IBPCI
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "bytecode.hpp"
+#include "resolver.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+namespace bc {
+
+class Compiler {
+ private:
+  ast::Tree &tree;
+  Program program;
+  rsv::scopes &scopes;
+  Chunk *chunk;
+  std::map<std::string, unsigned> method_ids;
+  std::map<std::int64_t, unsigned> int_constants;
+  std::map<double, unsigned> num_constants;
+  std::map<std::string, unsigned> str_constants;
+  // pending jumps out of the blocks being compiled, see block()
+  std::vector<std::vector<unsigned>> block_exits;
+  unsigned depth;
+
+  unsigned emit(opcode op, int a, int b, ast::node node);
+  unsigned here();
+  void patch(unsigned jump);
+  void patch(std::vector<unsigned> &jumps);
+  unsigned slot(ast::node leaf);
+  unsigned hidden_slots(unsigned count);
+  unsigned constant(std::int64_t value);
+  unsigned constant(double value);
+  unsigned constant(std::string value);
+  unsigned string(std::string value);
+  unsigned method_name(std::string name);
+  void error(std::string message, error_kind kind, ast::node node);
+  void method(ast::node root);
+  void stmt(ast::node root, bool top_level);
+  void block(ast::node root, bool method_body);
+  void if_stmt(ast::node root);
+  void loop_whl(ast::node root);
+  void loop_for(ast::node root);
+  void assign(ast::node root);
+  void std_void(ast::node root);
+  void method_call(ast::node root);
+  void output(ast::node root);
+  void expr(ast::node root);
+  void branch(ast::node root, bool jump_if, std::vector<unsigned> &jumps);
+  void make_array(ast::node root);
+  bool get_contents(ast::node root, std::vector<unsigned> &dims,
+                    unsigned nesting, std::vector<ast::node> &elements);
+  void std_return(ast::node root);
+
+ public:
+  Compiler(ast::Tree &tree, rsv::scopes &scopes);
+  Program compile();
+};
+
+}  // namespace bc
+
+#endif
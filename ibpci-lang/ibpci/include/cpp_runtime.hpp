@@ -0,0 +1,674 @@
+#ifndef CPP_RUNTIME_HPP
+#define CPP_RUNTIME_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <initializer_list>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "token.hpp"
+
+// The runtime of programs translated to C++ by IBPCI::CppEmitter. It is the
+// whole of what they need next to the standard library: values behave as
+// val::Value does in the interpreter and every check fails with the message
+// the interpreter prints, at the line the emitter passes in.
+namespace rt {
+
+// INT and NUM are both the NUM of the language, NUM holds the fractional ones;
+// INT comes first so that a value of zeroed bytes is the number 0
+enum value_kind : std::uint8_t {
+  INT,
+  NUM,
+  UNDEFINED,
+  VOID,
+  STR,
+  ARR,
+  STACK,
+  QUEUE
+};
+
+struct Object {
+  unsigned refs{1};
+  Object() = default;
+  // a copy starts out unshared
+  Object(const Object &) {}
+  virtual ~Object() = default;
+  virtual Object *clone() const = 0;
+};
+
+class Value {
+ public:
+  value_kind kind;
+  union {
+    std::int64_t i;
+    double num;
+    Object *obj;
+  };
+
+  Value() : kind(UNDEFINED), i(0) {}
+  explicit Value(std::int64_t n) : kind(INT), i(n) {}
+  explicit Value(double n) : kind(NUM), num(n) {}
+  explicit Value(value_kind k) : kind(k), i(0) {}
+  Value(value_kind k, Object *o) : kind(k), obj(o) {}
+  inline Value(std::string str, int id);
+
+  Value(const Value &v) : kind(v.kind) {
+    if (v.is_object()) {
+      obj = v.obj;
+      obj->refs++;
+    } else {
+      i = v.i;
+    }
+  }
+
+  Value(Value &&v) noexcept : kind(v.kind) {
+    if (v.is_object())
+      obj = v.obj;
+    else
+      i = v.i;
+    v.kind = UNDEFINED;
+  }
+
+  Value &operator=(const Value &v) {
+    if (v.is_object()) v.obj->refs++;
+    release();
+    kind = v.kind;
+    if (is_object())
+      obj = v.obj;
+    else
+      i = v.i;
+    return *this;
+  }
+
+  Value &operator=(Value &&v) noexcept {
+    if (this != &v) {
+      release();
+      kind = v.kind;
+      if (is_object())
+        obj = v.obj;
+      else
+        i = v.i;
+      v.kind = UNDEFINED;
+    }
+    return *this;
+  }
+
+  ~Value() { release(); }
+
+  bool is_number() const { return kind == INT || kind == NUM; }
+  bool is_object() const { return kind >= STR; }
+  bool is_container() const { return kind >= ARR; }
+  // containers are shared until one of the values is mutated
+  void detach() {
+    if (is_container() && obj->refs > 1) {
+      Object *copy = obj->clone();
+      obj->refs--;
+      obj = copy;
+    }
+  }
+
+ private:
+  void release() {
+    if (is_object() && --obj->refs == 0) delete obj;
+  }
+};
+
+struct String : Object {
+  // id of the token the string was lexed as, input() may produce identifiers
+  int id;
+  std::string str;
+  String(std::string str, int id) : id(id), str(std::move(str)) {}
+  Object *clone() const override { return new String(*this); }
+};
+
+// array storage comes zeroed from calloc, so Array(N) only touches the pages
+// the program writes to
+template <class T>
+struct ZeroAllocator {
+  using value_type = T;
+  ZeroAllocator() = default;
+  template <class U>
+  ZeroAllocator(const ZeroAllocator<U> &) {}
+  T *allocate(std::size_t n) {
+    void *p = std::calloc(n, sizeof(T));
+    if (p == nullptr) throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+  void deallocate(T *p, std::size_t) { std::free(p); }
+  // value-initialized elements are left as the zeroed bytes
+  template <class U>
+  void construct(U *) {}
+  template <class U, class... Args>
+  void construct(U *p, Args &&...args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+  bool operator==(const ZeroAllocator &) const { return true; }
+  bool operator!=(const ZeroAllocator &) const { return false; }
+};
+
+struct Array : Object {
+  std::vector<unsigned> dims;
+  std::vector<Value, ZeroAllocator<Value>> items;
+  Object *clone() const override { return new Array(*this); }
+};
+
+// stacks take from the front, queues from the back
+struct Sequence : Object {
+  std::deque<Value> items;
+  Object *clone() const override { return new Sequence(*this); }
+};
+
+Value::Value(std::string str, int id)
+    : kind(STR), obj(new String(std::move(str), id)) {}
+
+inline String *as_string(const Value &v) {
+  return static_cast<String *>(v.obj);
+}
+
+inline Array *as_array(const Value &v) { return static_cast<Array *>(v.obj); }
+
+inline Sequence *as_sequence(const Value &v) {
+  return static_cast<Sequence *>(v.obj);
+}
+
+inline double to_double(const Value &v) {
+  return v.kind == INT ? (double)v.i : v.num;
+}
+
+inline std::int64_t to_int(const Value &v) {
+  if (v.kind == INT) return v.i;
+  if (v.num >= 9223372036854775808.0) return INT64_MAX;
+  if (v.num < -9223372036854775808.0) return INT64_MIN;
+  return v.num == v.num ? (std::int64_t)v.num : 0;
+}
+
+inline int type_id(const Value &v) {
+  if (v.is_number()) return tk::NUM;
+  return v.kind == STR ? as_string(v)->id : -1;
+}
+
+inline bool same_type(const Value &l, const Value &r) {
+  if (l.kind != r.kind) return l.is_number() && r.is_number();
+  return l.kind != STR || type_id(l) == type_id(r);
+}
+
+inline std::string type_name(const Value &v) {
+  switch (v.kind) {
+    case INT:
+    case NUM:
+    case STR: {
+      int id = type_id(v);
+      if (id < 0 || id >= (int)std::size(tk::ID_NAMES)) return "NULL";
+      return std::string(tk::ID_NAMES[id]);
+    }
+    case ARR:
+      return "ARRAY";
+    case STACK:
+      return "STACK";
+    case QUEUE:
+      return "QUEUE";
+    case VOID:
+      return "VOID";
+    default:
+      return "UNDEFINED";
+  }
+}
+
+[[noreturn]] inline void error(const std::string &message, unsigned line) {
+  std::cout << "SEMANTIC ERROR at line " << line << ": " << message
+            << std::endl;
+  std::exit(1);
+}
+
+[[noreturn]] inline void error_rt(const std::string &message, unsigned line) {
+  std::cout << "RUN-TIME error at line " << line << ": " << message
+            << std::endl;
+  std::exit(1);
+}
+
+inline const Value &read(const Value &v, unsigned line, const char *name) {
+  if (v.kind == UNDEFINED)
+    error_rt(std::string("undefined reference to variable ") + name, line);
+  return v;
+}
+
+inline Value &read(Value &v, unsigned line, const char *name) {
+  if (v.kind == UNDEFINED)
+    error_rt(std::string("undefined reference to variable ") + name, line);
+  return v;
+}
+
+inline void print(const Value &v) {
+  switch (v.kind) {
+    case INT:
+      std::cout << (double)v.i;
+      break;
+    case NUM:
+      std::cout << v.num;
+      break;
+    case STR:
+      std::cout << as_string(v)->str;
+      break;
+    case ARR:
+      for (auto &a : as_array(v)->items) {
+        print(a);
+        std::cout << " ";
+      }
+      break;
+    case STACK:
+    case QUEUE:
+      for (auto &a : as_sequence(v)->items) {
+        print(a);
+        std::cout << " ";
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+inline void newline() { std::cout << std::endl; }
+
+// arithmetic, integers stay integers unless the result is fractional or does
+// not fit into 64 bits
+template <int op>
+Value arith(const Value &l, const Value &r, unsigned line) {
+  if (l.is_number() && r.is_number()) {
+    std::int64_t out;
+    bool ints = l.kind == INT && r.kind == INT;
+    switch (op) {
+      case tk::PLUS:
+        if (ints && !__builtin_add_overflow(l.i, r.i, &out)) return Value(out);
+        return Value(to_double(l) + to_double(r));
+      case tk::MINUS:
+        if (ints && !__builtin_sub_overflow(l.i, r.i, &out)) return Value(out);
+        return Value(to_double(l) - to_double(r));
+      case tk::MULT:
+        if (ints && !__builtin_mul_overflow(l.i, r.i, &out)) return Value(out);
+        return Value(to_double(l) * to_double(r));
+      case tk::DIV_WOQ:
+        if (to_double(r) == 0) error_rt("Division by 0 is illegal", line);
+        if (ints && r.i != -1 && l.i % r.i == 0) return Value(l.i / r.i);
+        return Value(to_double(l) / to_double(r));
+      default: {
+        std::int64_t a = to_int(l), b = to_int(r);
+        if (b == 0) error_rt("Division by 0 is illegal", line);
+        if (op == tk::MOD) return Value(b == -1 ? 0 : a % b);
+        if (b != -1) return Value(a / b);
+        if (a == INT64_MIN) return Value(-(double)a);
+        return Value(-a);
+      }
+    }
+  }
+  if (!same_type(l, r))
+    error_rt("Incompatible types: " + type_name(l) + " and " + type_name(r),
+             line);
+  if (l.kind == STR) {
+    if (op != tk::PLUS)
+      error_rt("cannot make this type of comparison on strings", line);
+    return Value(as_string(l)->str + as_string(r)->str, tk::STRING);
+  }
+  error_rt("cannot make this type of operation on " + type_name(l), line);
+}
+
+template <int op, typename T>
+bool compare_as(T l, T r) {
+  switch (op) {
+    case tk::LT:
+      return l < r;
+    case tk::GT:
+      return l > r;
+    case tk::LEQ:
+      return l <= r;
+    case tk::GEQ:
+      return l >= r;
+    case tk::DNEQ:
+      return l != r;
+    default:
+      return l == r;
+  }
+}
+
+template <int op>
+bool compare(const Value &l, const Value &r, unsigned line) {
+  if (l.kind == INT && r.kind == INT) return compare_as<op>(l.i, r.i);
+  if (l.is_number() && r.is_number())
+    return compare_as<op>(to_double(l), to_double(r));
+  if (!same_type(l, r))
+    error_rt("Incompatible types: " + type_name(l) + " and " + type_name(r),
+             line);
+  if (l.kind == STR) {
+    if (op != tk::IS)
+      error_rt("cannot make this type of comparison on strings", line);
+    return as_string(l)->str == as_string(r)->str;
+  }
+  error_rt("cannot make this type of comparison on " + type_name(l), line);
+}
+
+inline Value negative(const Value &v, unsigned line) {
+  if (!v.is_number())
+    error_rt("Cannot make negative value from " + type_name(v), line);
+  if (v.kind == NUM) return Value(-v.num);
+  if (v.i == INT64_MIN) return Value(-(double)v.i);
+  return Value(-v.i);
+}
+
+// the bounds of a counting loop, which counts down when from is larger
+struct Range {
+  std::int64_t from;
+  std::int64_t to;
+  std::int64_t step;
+};
+
+inline Range range(const Value &from, const Value &to, unsigned line) {
+  if (!from.is_number() || !to.is_number())
+    error_rt("Incompatible types: " + type_name(from) + " and " +
+                 type_name(to),
+             line);
+  std::int64_t f = to_int(from), t = to_int(to);
+  return {f, t, f < t ? 1 : -1};
+}
+
+inline Value stack() { return Value(STACK, new Sequence); }
+
+inline Value queue() { return Value(QUEUE, new Sequence); }
+
+// an array literal, its shape was checked when it was emitted
+inline Value array(std::initializer_list<unsigned> dims,
+                   std::initializer_list<Value> items) {
+  Array *arr = new Array;
+  arr->dims = dims;
+  arr->items = items;
+  return Value(ARR, arr);
+}
+
+inline Value empty_array() { return Value(ARR, new Array); }
+
+// Array(...) takes its dimensions one at a time, each is checked before the
+// next one is computed
+inline void dimension(Value &arr, const Value &arg, unsigned line) {
+  if (!arg.is_number() || to_double(arg) < 0)
+    error("Only viable argument is a number", line);
+  as_array(arr)->dims.push_back(to_int(arg));
+}
+
+inline void zeros(Value &arr) {
+  std::size_t size = 1;
+  for (auto a : as_array(arr)->dims) size *= a;
+  as_array(arr)->items.resize(size);
+}
+
+inline Array *lookup_array(const Value &v, unsigned line, const char *name) {
+  read(v, line, name);
+  if (v.kind != ARR) error(std::string(name) + " is not an array", line);
+  return as_array(v);
+}
+
+// row-major address of the element, every key is checked against its
+// dimension
+inline std::size_t address(const Array *arr, const Value *keys,
+                           unsigned count, unsigned line) {
+  unsigned addr = 0;
+  long long key;
+  if (count != arr->dims.size())
+    error("array has " + std::to_string(arr->dims.size()) + " dimensions, " +
+              std::to_string(count) + " indices given",
+          line);
+  for (unsigned i = 0; i < count; ++i) {
+    if (!keys[i].is_number()) error("Only viable argument is a number", line);
+    key = to_int(keys[i]);
+    if (key < 0 || key >= arr->dims[i])
+      error("index " + std::to_string(key) + " out of bounds", line);
+    addr = addr * arr->dims[i] + key;
+  }
+  return addr;
+}
+
+inline Value at(const Value &v, unsigned line, const char *name,
+                const Value &key) {
+  Array *arr = lookup_array(v, line, name);
+  return arr->items[address(arr, &key, 1, line)];
+}
+
+inline Value at(const Value &v, unsigned line, const char *name,
+                std::initializer_list<Value> keys) {
+  Array *arr = lookup_array(v, line, name);
+  return arr->items[address(arr, keys.begin(), keys.size(), line)];
+}
+
+inline void store(Value &v, unsigned line, const char *name, const Value &key,
+                  Value in) {
+  std::size_t addr = address(lookup_array(v, line, name), &key, 1, line);
+  v.detach();
+  as_array(v)->items[addr] = std::move(in);
+}
+
+inline void store(Value &v, unsigned line, const char *name,
+                  std::initializer_list<Value> keys, Value in) {
+  std::size_t addr =
+      address(lookup_array(v, line, name), keys.begin(), keys.size(), line);
+  v.detach();
+  as_array(v)->items[addr] = std::move(in);
+}
+
+inline void push(Value &v, unsigned line, const char *name, Value in) {
+  if (read(v, line, name).kind != STACK)
+    error("'push' can only be done on a stack", line);
+  v.detach();
+  as_sequence(v)->items.push_back(std::move(in));
+}
+
+inline void enqueue(Value &v, unsigned line, const char *name, Value in) {
+  if (read(v, line, name).kind != QUEUE)
+    error("'enqueue' can only be done on a queue", line);
+  v.detach();
+  as_sequence(v)->items.push_back(std::move(in));
+}
+
+inline std::int64_t size(const Value &v) {
+  switch (v.kind) {
+    case ARR:
+      return as_array(v)->items.size();
+    case STACK:
+    case QUEUE:
+      return as_sequence(v)->items.size();
+    case VOID:
+      return 0;
+    default:
+      return 1;
+  }
+}
+
+inline Value length(const Value &v, unsigned line, const char *name) {
+  return Value(size(read(v, line, name)));
+}
+
+inline Value pop(Value &v, unsigned line, const char *name) {
+  if (read(v, line, name).kind != STACK)
+    error("'pop' can only be performed on stacks", line);
+  if (size(v) == 0) error("Cannot perform 'pop' on an empty stack", line);
+  v.detach();
+  Value out = std::move(as_sequence(v)->items.front());
+  as_sequence(v)->items.pop_front();
+  return out;
+}
+
+inline Value dequeue(Value &v, unsigned line, const char *name) {
+  if (read(v, line, name).kind != QUEUE)
+    error("'dequeue' can only be performed on queues", line);
+  if (size(v) == 0) error("Cannot perform 'pop' on an empty stack", line);
+  v.detach();
+  Value out = std::move(as_sequence(v)->items.back());
+  as_sequence(v)->items.pop_back();
+  return out;
+}
+
+inline Value get_next(const Value &v, unsigned line, const char *name) {
+  if (!read(v, line, name).is_container() || size(v) == 0)
+    error("cannot perform 'getNext()' on an empty container", line);
+  if (v.kind == ARR)
+    error("'getNext()' can only be perfromed on a stack or a queue", line);
+  if (v.kind == STACK) return as_sequence(v)->items.front();
+  return as_sequence(v)->items.back();
+}
+
+inline Value has_next(const Value &v, unsigned line, const char *name) {
+  read(v, line, name);
+  return Value((std::int64_t)(v.is_container() && size(v) > 0 ? 1 : 0));
+}
+
+inline Value is_empty(const Value &v, unsigned line, const char *name) {
+  read(v, line, name);
+  return Value((std::int64_t)(v.is_container() && size(v) > 0 ? 0 : 1));
+}
+
+// The first token of a word, lexed the way lxr::Lexer lexes it. Returns false
+// with the character the lexer would have stopped at when there is none.
+inline bool first_token(const std::string &word, Value &out, char &stuck) {
+  auto lower = [](char c) { return c >= 'a' && c <= 'z'; };
+  auto upper = [](char c) { return c >= 'A' && c <= 'Z'; };
+  auto digit = [](char c) { return c >= '0' && c <= '9'; };
+  std::size_t end = word.size(), pos = 0;
+  auto peek = [&](std::size_t i) { return i < end ? word[i] : (char)EOF; };
+  char c = word[0];
+  if (digit(c)) {
+    while (digit(peek(pos))) ++pos;
+    bool integer = peek(pos) != '.';
+    if (!integer)
+      for (++pos; digit(peek(pos));) ++pos;
+    double num = 0;
+    std::from_chars(word.data(), word.data() + pos, num);
+    std::int64_t value;
+    auto result = std::from_chars(word.data(), word.data() + pos, value);
+    if (integer && result.ec == std::errc() && value <= 9007199254740992)
+      out = Value((std::int64_t)num);
+    else
+      out = Value(num);
+    return true;
+  }
+  if (upper(c) || lower(c)) {
+    bool variable = upper(c);
+    for (pos = 1; pos < end; ++pos) {
+      c = word[pos];
+      if (lower(c)) variable = false;
+      if (!(upper(c) || digit(c) || c == '_' || (!variable && lower(c))))
+        break;
+    }
+    std::string text = word.substr(0, pos);
+    int id = tk::lookup_keyword(text);
+    if (id == 0) id = variable ? tk::ID_VAR : tk::ID_METHOD;
+    out = Value(text, id);
+    return true;
+  }
+  switch (c) {
+    // a string runs up to its closing quote or the EOF byte
+    case '"': {
+      std::size_t close = 1;
+      while (close < end && word[close] != '"' && word[close] != (char)EOF)
+        ++close;
+      out = Value(word.substr(1, close - 1), tk::STRING);
+      return true;
+    }
+    // a comment takes the rest of the word, the file ends after it
+    case '/':
+      if (peek(1) == '/')
+        out = Value("EOF", tk::END_FILE);
+      else
+        out = Value("/", tk::DIV_WOQ);
+      return true;
+    case '=':
+      if (peek(1) == '=')
+        out = Value("==", tk::IS);
+      else
+        out = Value("=", tk::EQ);
+      return true;
+    case '<':
+      if (peek(1) == '=')
+        out = Value("<=", tk::LEQ);
+      else
+        out = Value("<", tk::LT);
+      return true;
+    case '>':
+      if (peek(1) == '=')
+        out = Value(">=", tk::GEQ);
+      else
+        out = Value(">", tk::GT);
+      return true;
+    case '!':
+      if (peek(1) != '=') {
+        stuck = peek(1);
+        return false;
+      }
+      out = Value("!=", tk::DNEQ);
+      return true;
+    case '+':
+      out = Value("+", tk::PLUS);
+      return true;
+    case '-':
+      out = Value("-", tk::MINUS);
+      return true;
+    case '*':
+      out = Value("*", tk::MULT);
+      return true;
+    case '%':
+      out = Value("%", tk::MOD);
+      return true;
+    // '[' has always been spelled the other way round
+    case '[':
+      out = Value("]", tk::LSQBR);
+      return true;
+    case ']':
+      out = Value("]", tk::RSQBR);
+      return true;
+    case '(':
+      out = Value("(", tk::LPAREN);
+      return true;
+    case ')':
+      out = Value(")", tk::RPAREN);
+      return true;
+    case '.':
+      out = Value(".", tk::DOT);
+      return true;
+    case ',':
+      out = Value(",", tk::COMMA);
+      return true;
+    case (char)EOF:
+      out = Value("EOF", tk::END_FILE);
+      return true;
+  }
+  stuck = c;
+  return false;
+}
+
+inline Value input(std::string_view prompt, unsigned line) {
+  std::cout << prompt;
+  std::string buffer;
+  std::cin >> buffer;
+  // a failed read is reported as the unexpected character it leaves behind
+  if (buffer.empty()) buffer.push_back('\0');
+  std::cout << std::endl;
+  Value out;
+  char stuck;
+  if (!first_token(buffer, out, stuck))
+    error(std::string("Unexpected character at line 1: '") + stuck + "'\n",
+          line);
+  return out;
+}
+
+// a method is bound to its name once its declaration has run
+inline void declare(bool &declared, unsigned line) {
+  if (declared) error("Duplicate method declaration", line);
+  declared = true;
+}
+
+}  // namespace rt
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+// Debug builds can trace what the lexer, the parser and the runtime do, on
+// std::cerr and only for the categories and down to the level switched on.
+// Release builds (NDEBUG) compile every DIAGNOSE away, arguments included.
+#ifndef NDEBUG
+#define IBPCI_DIAGNOSTICS
+#endif
+
+namespace dg {
+
+// from the most to the least verbose
+enum level : std::uint8_t { TRACE, DEBUG, INFO, OFF };
+
+enum category : std::uint8_t { LEXER = 1, PARSER = 2, RUNTIME = 4, ALL = 7 };
+
+struct Settings {
+  level threshold{OFF};
+  unsigned categories{0};
+};
+
+extern Settings settings;
+
+inline bool enabled(level at, category in) {
+  return at >= settings.threshold && (settings.categories & in);
+}
+
+// switches diagnostics on from a spec like "lexer,parser:trace", the level
+// defaults to debug; false when the spec has an unknown name in it
+bool configure(std::string_view spec);
+
+// std::cerr with the category and the level in front
+std::ostream &log(level at, category in);
+
+}  // namespace dg
+
+#ifdef IBPCI_DIAGNOSTICS
+#define DIAGNOSE(at, in, message)                      \
+  do {                                                 \
+    if (dg::enabled(dg::at, dg::in))                   \
+      dg::log(dg::at, dg::in) << message << std::endl; \
+  } while (0)
+#else
+#define DIAGNOSE(at, in, message) \
+  do {                            \
+  } while (0)
+#endif
+
+#endif
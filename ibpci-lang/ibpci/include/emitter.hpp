@@ -0,0 +1,91 @@
+#ifndef EMITTER_HPP
+#define EMITTER_HPP
+
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "resolver.hpp"
+#include "token.hpp"
+
+namespace IBPCI {
+
+// Translates a resolved program into a C++17 translation unit that runs it
+// on the runtime in cpp_runtime.hpp, with the output and the errors of
+// Interpreter. Every method becomes a function and every scope an array of
+// values indexed by the slots of its variables. Expressions are computed
+// into temporaries one operand at a time, so the operands are computed and
+// checked in the order the interpreter computes and checks them.
+class CppEmitter {
+ private:
+  // CONSTANTs are expressions without effects, REFERENCEs name a variable
+  // read in place, TEMPORARYs name a value the emitted code owns
+  enum operand_kind { CONSTANT, REFERENCE, TEMPORARY };
+
+  struct Operand {
+    std::string code;
+    operand_kind kind;
+  };
+
+  ast::Tree &tree;
+  rsv::scopes &scopes;
+  const rsv::Scope *scope{nullptr};
+  // the function being emitted, one indented line at a time
+  std::vector<std::string> lines;
+  unsigned depth{0};
+  unsigned temps{0};
+  // string literals are defined once, up front
+  std::map<std::string, unsigned> strings;
+  std::string constants;
+  // the first declaration of every method name
+  std::map<std::string, unsigned> method_ids;
+  std::vector<ast::node> methods;
+
+  void line(const std::string &code);
+  std::string temp(const std::string &prefix);
+  std::string function(unsigned id);
+  std::string take(const Operand &value);
+  Operand snapshot(const Operand &value);
+  std::string variable(ast::node leaf);
+  std::string name(ast::node leaf);
+  std::string frame();
+  std::string body();
+
+  void method(unsigned id);
+  void statement(ast::node root);
+  bool block(ast::node root, bool returns);
+  void method_decl(ast::node root);
+  void exec_if(ast::node root);
+  void exec_whl(ast::node root);
+  void exec_for(ast::node root);
+  void assign(ast::node root);
+  void std_void(ast::node root);
+  void output(ast::node root);
+  void unexpected(ast::node root);
+  Operand compute(ast::node root);
+  Operand string_constant(const std::string &text);
+  std::string method_call(ast::node root);
+  Operand make_array(ast::node root);
+  bool get_contents(ast::node root, std::vector<unsigned> &dims,
+                    unsigned nesting, std::vector<ast::node> &elements,
+                    std::string &message, ast::node &at);
+  Operand declare_empty_array(ast::node root);
+  std::string keys(ast::node accessor);
+  Operand std_return(ast::node root);
+  std::string condition(ast::node root);
+
+ public:
+  CppEmitter(ast::Tree &tree, rsv::scopes &scopes);
+  std::string emit();
+};
+
+// text as a C++ string literal
+std::string quote(const std::string &text);
+
+}  // namespace IBPCI
+
+#endif
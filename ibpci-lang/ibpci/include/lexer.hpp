@@ -1,11 +1,22 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include <array>
+#include <charconv>
+#include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#ifndef __EMSCRIPTEN__
+#include <atomic>
+#include <thread>
+#endif
+
+#include "diagnostics.hpp"
 #include "error.hpp"
 #include "token.hpp"
 
@@ -13,31 +24,79 @@ namespace lxr {
 
 const std::string noattr = "0";
 
+// sources shorter than this are lexed on one thread whatever is asked for
+const std::size_t PARALLEL_MIN = 1 << 22;
+
+// The whole source lexed ahead, one entry per token in every array. When the
+// lexer failed, error says why and the last entry is the token a parser
+// pulling tokens one at a time would have been left with.
+struct Tokens {
+  std::vector<std::uint8_t> ids;
+  std::vector<std::uint8_t> num_types;
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::uint32_t> lengths;
+  std::vector<std::uint32_t> lines;
+  // the value of NUM tokens, 0 for the others
+  std::vector<double> values;
+  bool failed{false};
+  Error error;
+
+  std::size_t size() const { return ids.size(); }
+  tk::Span span(std::size_t i) const {
+    return {offsets[i], lengths[i], ids[i], num_types[i], lines[i]};
+  }
+  void reserve(std::size_t count);
+  void push(const tk::Span &span, double value);
+  void pop();
+  // appends the tokens of a piece lexed on its own, moved down by lines
+  void append(const Tokens &piece, unsigned lines);
+};
+
+// The lexer does not own its source, the buffer has to outlive it and the
+// spans it returns. A streaming lexer reads its source from an istream a
+// chunk at a time instead, its spans only hold until the next token is read.
 class Lexer {
  private:
-  std::string input_buffer;
-  std::string attr_buffer;
+  std::string_view source;
   Error current_error;
   bool error_flag{false};
-  int pos, len;
-  char c;
-
-  void set_error();
-  void advance();
-  void skip_whitespace();
-  void skip_comment();
-  tk::Token number();
-  tk::Token id();
-  tk::Token string();
-  tk::Token equals_operator(char base_character);
+  std::uint32_t pos{0}, end{0};
+  // streaming: source views window, which holds the unread part of the
+  // chunks
+  std::istream *in{nullptr};
+  std::size_t chunk{0};
+  std::string window;
+
+  void set_error(char c);
+  int scan(std::uint32_t &start);
+  bool refill(std::uint32_t &start);
+  void number(tk::Span &span);
+  void tokenize_parallel(Tokens &tokens, unsigned threads);
 
  public:
-  Lexer(std::string buffer);
+  Lexer(std::string_view source);
+  // lexes source from begin up to end, starting at line
+  Lexer(std::string_view source, std::uint32_t begin, std::uint32_t end,
+        unsigned line);
+  Lexer(std::istream &in, std::size_t chunk);
+  Lexer(const Lexer &) = delete;
+  Lexer &operator=(const Lexer &) = delete;
   Lexer() = default;
   ~Lexer() = default;
   unsigned int line_num;
-  Error get_error();
+  Error get_error() const;
+  bool failed() const { return error_flag; }
+  std::string_view get_source() const { return source; }
 
+  int next_span(tk::Span &span);
+  // threads 0 uses every core there is
+  void tokenize(Tokens &tokens, unsigned threads = 0);
+  std::string_view text(const tk::Span &span) const {
+    return source.substr(span.offset, span.length);
+  }
+  std::string_view lexeme(const tk::Span &span) const;
+  double value(const tk::Span &span) const;
+  tk::Token to_token(const tk::Span &span) const;
   int get_next_token(tk::Token &token);
 };
 
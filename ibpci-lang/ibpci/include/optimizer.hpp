@@ -0,0 +1,112 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "resolver.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+namespace opt {
+
+// what the command line asks of the optimizer
+struct Options {
+  unsigned level{0};
+  bool stats{false};
+};
+
+// Rewrites a resolved tree into one that runs with the same output and the
+// same errors in fewer steps. Every pass goes through main and the bodies of
+// the methods that are parsed, and counts what it changed:
+//  * constant folding (-O1) computes BINOP and UN_MIN over literals, an
+//    operation that would fail is left to fail when it runs
+//  * constant propagation (-O2) puts the literal a variable is assigned at
+//    the top level of its body, and nowhere else, in place of the reads of
+//    the variable in the statements after the assignment
+//  * constant conditions (-O1) decides CMP and COND over literals, drops the
+//    arms of if statements and the while loops that can never run and
+//    replaces an if statement whose first arm always runs by its block
+//  * unreachable code (-O1) drops the statements after a return in a block
+//  * loop-invariant code motion (-O2) computes the arithmetic and the lengths
+//    in a loop that come out the same on every iteration once before the
+//    loop, into new variables of the scope that no program can name
+// At -O2 the passes run again for as long as one of them changes something.
+class PassManager {
+ private:
+  struct Pass {
+    const char *name;
+    const char *unit;
+    unsigned level;
+    unsigned (PassManager::*run)(ast::node body);
+    unsigned changes;
+  };
+
+  // an arm of an if statement, root is the IF or the ELIF node it came from
+  struct Arm {
+    ast::node root;
+    ast::node cond;
+    ast::node block;
+  };
+
+  ast::Tree &tree;
+  rsv::scopes &scopes;
+  unsigned level;
+  std::vector<Pass> passes;
+  // the scope of the body hoist goes through and its variables that only
+  // ever hold numbers
+  rsv::Scope *scope{nullptr};
+  std::set<int> numbers;
+
+  ast::node statements(ast::node body);
+  void set_children(ast::node n, const std::vector<ast::node> &children);
+  bool literal(ast::node n, val::Value &out);
+  bool make_literal(ast::node n, const val::Value &value);
+  bool spliceable(ast::node block);
+
+  unsigned fold(ast::node body);
+  unsigned fold_tree(ast::node n);
+  bool fold_binop(ast::node n);
+  bool fold_negative(ast::node n);
+
+  unsigned propagate(ast::node body);
+  void count_writes(ast::node n, std::map<int, unsigned> &writes);
+  unsigned replace_reads(ast::node n, int slot, ast::node value);
+
+  unsigned conditions(ast::node body);
+  unsigned branches(ast::node parent);
+  unsigned exec_if(ast::node root, std::vector<ast::node> &out);
+  ast::node reduce(ast::node cond, unsigned &changes);
+  int truth(ast::node cond);
+
+  unsigned unreachable(ast::node body);
+  unsigned blocks(ast::node parent);
+
+  unsigned hoist(ast::node body);
+  void number_variables(ast::node list);
+  void assignments(ast::node n, std::vector<ast::node> &out);
+  unsigned loops(ast::node parent, std::set<int> defined);
+  void mutations(ast::node n, std::set<int> &written);
+  unsigned lift(ast::node n, const std::set<int> &written,
+                const std::set<int> &defined, std::vector<ast::node> &out);
+  bool invariant(ast::node n, const std::set<int> &written,
+                 const std::set<int> &defined);
+  bool numeric(ast::node n);
+  bool total(ast::node n);
+  void make_variable(ast::node n, int slot, std::uint32_t name);
+  ast::node temporary(ast::node n);
+
+ public:
+  PassManager(ast::Tree &tree, rsv::scopes &scopes, unsigned level);
+  void run();
+  void print_stats(std::ostream &out);
+};
+
+}  // namespace opt
+
+#endif
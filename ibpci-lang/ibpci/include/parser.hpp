@@ -1,53 +1,139 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
 
 #include "ast.hpp"
+#include "diagnostics.hpp"
 #include "error.hpp"
 #include "lexer.hpp"
 #include "token.hpp"
 
 namespace prs {
 
+// the tokens [first, last) of a method body, last is the 'end' of the
+// 'end method' that closes it
+struct Body {
+  std::size_t first;
+  std::size_t last;
+};
+
+// The parser reads the tokens of a whole source from a lxr::Tokens buffer by
+// index, a streaming parser pulls them from its lexer one at a time. token is
+// the current one in both cases.
 class Parser {
  private:
   lxr::Lexer lex;
-  tk::Token token;
+  tk::Span token;
+  lxr::Tokens lexed;
+  const lxr::Tokens *tokens{nullptr};
+  std::size_t cursor{0};
 
+  void read(const lxr::Tokens &buffer);
+  bool advance();
+  unsigned line() const;
+  Error lex_error() const;
+  bool lexer_failed() const;
   void eat(int token_id);
-  void error(int token_id);
   void set_error(int token_id);
   bool error_flag{false};
   Error current_error;
+  // recovering: every error so far
+  bool recover{false};
+  std::vector<Error> errors;
+  ast::Tree *tree{nullptr};
+  // children of the nodes under construction, a node takes the ones above
+  // the mark it was opened with when it is closed
+  std::vector<ast::node> scratch;
+  // views of the strings of the tree
+  std::unordered_map<std::string_view, std::uint32_t> interned;
+  // streaming: sizes of the buffers of the tree before the last statement
+  std::size_t nodes_mark, kids_mark, numbers_mark, strings_mark;
+  // lazy: the tokens of every skipped method body
+  bool lazy{false};
+  std::unordered_map<ast::node, Body> bodies;
+
+  bool skip_body(ast::node method);
+  ast::Tree *parse_tree();
+  bool parse_bodies(unsigned threads);
+  void merge(const ast::Tree &arena, const std::vector<ast::node> &roots,
+             const std::vector<ast::node> &methods);
+  std::uint32_t intern(std::string_view text);
+
+  ast::node open(int id);
+  ast::node open(int id, const tk::Span &token);
+  void close(ast::node n, std::size_t mark);
+
+  bool at_end() const;
+  void synchronize(std::size_t first);
 
-  ast::AST *stmt();
-  ast::AST *block();
-  ast::AST *if_block();
-  ast::AST *method();
-  ast::AST *ret();
-  ast::AST *loop_whl();
-  ast::AST *loop_for();
-  ast::AST *if_stmt();
-  ast::AST *else_stmt();
-  ast::AST *elif_stmt();
-  ast::AST *cond();
-  ast::AST *cmp();
-  ast::AST *assign();
-  ast::AST *method_call();
-  ast::AST *expr();
-  ast::AST *term();
-  ast::AST *factor();
-  ast::AST *arr();
-  ast::AST *arr_dyn();
-  ast::AST *std_method();
-  ast::AST *in_out();
+  ast::node statement();
+  ast::node stmt();
+  ast::node block();
+  ast::node if_block();
+  ast::node method();
+  ast::node ret();
+  ast::node loop_whl();
+  ast::node loop_for();
+  ast::node if_stmt();
+  ast::node else_stmt();
+  ast::node elif_stmt();
+  ast::node cond();
+  ast::node cmp();
+  ast::node assign();
+  ast::node method_call();
+  ast::node expr();
+  ast::node term();
+  ast::node factor();
+  ast::node arr();
+  ast::node arr_dyn();
+  ast::node std_method();
+  ast::node in_out();
 
  public:
-  Parser(std::string buffer);
+  // the source has to outlive the parser
+  Parser(std::string_view source);
+  // parses the tokens lexed from source before
+  Parser(std::string_view source, const lxr::Tokens &tokens);
+  // streaming: the source is read from in a chunk at a time
+  Parser(std::istream &in, std::size_t chunk);
   Error get_error();
-  ast::AST *parse();
+  bool failed() const { return error_flag; }
+  int peek(std::size_t ahead) const;
+  // big token buffers are parsed on threads, 0 uses every core there is
+  ast::Tree *parse(unsigned threads = 0);
+  // streaming: start() creates the tree and its START node, which never gets
+  // any children; next_stmt() then parses the statements one at a time into
+  // the tree and returns NONE at the end of the source or on an error.
+  // forget_stmt() drops the last statement from the tree, for statements that
+  // are not needed once they ran.
+  ast::Tree *start();
+  ast::node next_stmt();
+  void forget_stmt();
+  // lazy: parse() only notes where the bodies of methods are and leaves the
+  // methods without their BLOCK; parse_body() then parses the body of one of
+  // them into the tree, false on a syntax error in it. The parser has to
+  // outlive the tree for that.
+  void defer_bodies() { lazy = true; }
+  bool deferred(ast::node method) const { return bodies.count(method) > 0; }
+  bool parse_body(ast::node method);
+  // recovering: parse() goes on after a syntax error with the statement that
+  // follows the one it is in, which becomes an ERROR node, and returns the
+  // tree with all of them; statements cut off by the end of the source are
+  // kept as far as they got. Needs a token buffer and is not for trees that
+  // are to be run.
+  void recover_errors() { recover = true; }
+  const std::vector<Error> &get_errors() const { return errors; }
 };
 
 }  // namespace prs
@@ -0,0 +1,66 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+#include "error.hpp"
+#include "token.hpp"
+
+namespace rsv {
+
+// variables of main or of a method, parameters come first
+struct Scope {
+  std::string name;
+  std::vector<std::string> locals;
+  unsigned params{0};
+};
+
+// activation records point at their scope, the scopes never move
+typedef std::deque<Scope> scopes;
+
+// Gives every variable a fixed slot in the activation record of its scope.
+// Node::slot of a variable node indexes Scope::locals, Node::slot of the
+// START and METHOD nodes indexes the resolved scopes. Only the nodes the
+// interpreter evaluates are resolved.
+// A streaming resolver gets the statements of main one at a time as they are
+// parsed. Undefined references in main are then left to the interpreter,
+// whether a variable is assigned later on is not known yet.
+class Resolver {
+ private:
+  ast::Tree &tree;
+  scopes resolved;
+  unsigned current;
+  std::map<std::string, unsigned> slots;
+  std::vector<bool> bound;
+  std::vector<ast::node> first_read;
+  bool error_flag{false};
+  Error current_error;
+
+  Scope &scope();
+  void open_scope(std::string name);
+  void close_scope();
+  unsigned slot(ast::node leaf);
+  void bind(ast::node leaf);
+  void method(ast::node root);
+  void stmt(ast::node root);
+  void block(ast::node root);
+  void condition(ast::node root);
+  void expr(ast::node root);
+
+ public:
+  Resolver(ast::Tree &tree);
+  bool resolve();
+  void start();
+  bool resolve(ast::node root);
+  scopes &get_scopes();
+  Error get_error();
+};
+
+}  // namespace rsv
+
+#endif
@@ -10,65 +10,81 @@
 #include "ast.hpp"
 #include "call_stack.hpp"
 #include "lexer.hpp"
+#include "parser.hpp"
+#include "resolver.hpp"
 #include "token.hpp"
+#include "typer.hpp"
+#include "value.hpp"
 
 namespace IBPCI {
 
-const int VOID_RETURN = -1;
-
-typedef std::map<std::string, ast::AST *> method_map;
-typedef std::vector<std::unique_ptr<rf::Reference>> computed_params;
-typedef std::unique_ptr<rf::Reference> return_ref;
+typedef std::map<std::string, ast::node> method_map;
 
 class Interpreter {
  private:
   cstk::CallStack call_stack;
-  ast::AST *tree;
+  ast::Tree &tree;
+  rsv::scopes &scopes;
   method_map methods;
   bool log_stack;
-  void error(std::string message, ast::AST *leaf);
-  void error(std::string message, rf::Reference *token);
-  void method_decl(ast::AST *root);
-  rf::Reference *method_call(ast::AST *root);
-  void exec_if(ast::AST *root);
-  void exec_whl(ast::AST *root);
-  void exec_for(ast::AST *root);
-  rf::Reference *exec_block(ast::AST *root);
-  void assign(ast::AST *root);
-  rf::Reference *compute(ast::AST *root);
-  rf::Reference *binop(rf::Reference *l, rf::Reference *r, int op);
-  int check_types(rf::Reference *l, rf::Reference *r);
-  rf::Reference *add(rf::Reference *l, rf::Reference *r);
-  rf::Reference *divide(rf::Reference *l, rf::Reference *r, int op);
-  rf::Reference *negative(rf::Reference *val);
-  bool condition(ast::AST *root);
-  bool numerical_comparison(rf::Reference *l, rf::Reference *r, int op);
-  bool equal(rf::Reference *l, rf::Reference *r);
-  rf::Reference *declare_empty_array(ast::AST *root);
-  rf::Reference *make_array(ast::AST *root);
-  void get_contents(ast::AST *root, rf::Reference *arr, unsigned nesting);
-  void get_dimensions(ast::AST *root, rf::Reference *arr);
-  rf::Reference *access_array(ast::AST *root);
-  unsigned compute_key(ast::AST *accessor, rf::Reference *arr);
-  void std_void(ast::AST *root);
-  void push(ast::AST *root);
-  void enqueue(ast::AST *root);
-  rf::Reference *std_return(ast::AST *root);
-  rf::Reference *length(ast::AST *root);
-  rf::Reference *pop(ast::AST *root);
-  rf::Reference *dequeue(ast::AST *root);
-  rf::Reference *get_next(ast::AST *root);
-  rf::Reference *empty(ast::AST *root);
-  ast::AST *lookup_method(std::string key, ast::AST *leaf);
-  void collect_params(ast::AST *root, std::vector<rf::Reference *> *container);
-  void init_record(ast::AST *root, std::vector<rf::Reference *> *params);
+  // lazy: where the bodies of methods come from on their first call
+  prs::Parser *parser{nullptr};
+  rsv::Resolver *resolver{nullptr};
+  ty::Typer *typer{nullptr};
+  void load_body(ast::node method);
+  void error(std::string message, ast::node leaf);
+  void error_rt(std::string message, ast::node leaf);
+  void exec_stmt(ast::node root);
+  void method_decl(ast::node root);
+  val::Value method_call(ast::node root);
+  void exec_if(ast::node root);
+  void exec_whl(ast::node root);
+  void exec_for(ast::node root);
+  val::Value exec_block(ast::node root);
+  void assign(ast::node root);
+  val::Value compute(ast::node root);
+  val::Value binop(val::Value l, val::Value r, ast::node root);
+  void check_types(const val::Value &l, const val::Value &r, ast::node root);
+  val::Value arithmetic(const val::Value &l, const val::Value &r,
+                        ast::node root);
+  val::Value add(const val::Value &l, const val::Value &r);
+  val::Value divide(const val::Value &l, const val::Value &r, ast::node root);
+  val::Value negative(val::Value value, ast::node root);
+  bool condition(ast::node root);
+  bool numerical_comparison(val::Value l, val::Value r, ast::node root);
+  bool equal(const val::Value &l, const val::Value &r);
+  val::Value declare_empty_array(ast::node root);
+  val::Value make_array(ast::node root);
+  void get_contents(ast::node root, val::Array *arr, unsigned nesting,
+                    std::vector<ast::node> &elements);
+  void get_dimensions(ast::node root, val::Array *arr);
+  val::Value access_array(ast::node root);
+  val::Array *lookup_array(ast::node accessor);
+  unsigned compute_key(ast::node accessor, val::Value *keys, val::Array *arr);
+  void std_void(ast::node root);
+  void push(ast::node root);
+  void enqueue(ast::node root);
+  val::Value std_return(ast::node root);
+  val::Value length(ast::node root);
+  val::Value pop(ast::node root);
+  val::Value dequeue(ast::node root);
+  val::Value get_next(ast::node root);
+  val::Value has_next(ast::node root);
+  val::Value empty(ast::node root);
+  ast::node lookup_method(std::string key, ast::node leaf);
+  void collect_params(ast::node root, std::vector<val::Value> *container);
+  void init_record(ast::node root, std::vector<val::Value> *params);
   void print_methods();
-  rf::Reference *input(ast::AST *root);
-  void output(ast::AST *root);
+  val::Value input(ast::node root);
+  void output(ast::node root);
 
  public:
-  Interpreter(ast::AST *tree, bool log);
+  Interpreter(ast::Tree &tree, rsv::scopes &scopes, bool log);
+  // for a tree parsed with Parser::defer_bodies(), resolved by resolver
+  void parse_lazily(prs::Parser &parser, rsv::Resolver &resolver,
+                    ty::Typer &typer);
   void interpret();
+  void interpret(ast::node root);
 };
 
 }  // namespace IBPCI
@@ -1,10 +1,16 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace tk {
 
@@ -65,6 +71,18 @@ enum id {
   INPUT
 };
 
+// what id_to_str() calls every id, indexed by id
+constexpr std::string_view ID_NAMES[] = {
+    "EOF", "+", "-", "*", "/", "div", "mod", "[", "]", "(", ")", "\"", "<",
+    ">", "<=", ">=", "!=", "=", "==", "AND", "OR", ".", ",", "NULL", "NULL",
+    "NUM", "STRING", "NULL", "ID_VAR", "ID_METHOD", "method", "return", "loop",
+    "from", "to", "while", "until", "if", "else", "then", "end", "NULL", "NULL",
+    "NULL", "length", "get_next", "pop", "dequeue", "has_next", "push",
+    "enqueue", "is_empty", "output", "intput"};
+
+static_assert(std::size(ID_NAMES) == INPUT + 1,
+              "every token id needs a name");
+
 class Token {
  public:
   Token(std::string val);
@@ -79,6 +97,8 @@ class Token {
 
   int id, op;
   double val_num;
+  // INT for literals without a fractional part that a double holds exactly
+  int num_type{FLOAT};
   std::string val_str;
   unsigned line;
   void mutate(int id, std::string val, unsigned ln);
@@ -88,36 +108,91 @@ class Token {
   Token operator+(Token &t);
 };
 
-const std::map<std::string, int> RESERVED_KEYWORDS = {{"div", DIV_WQ},
-                                                      {"mod", MOD},
-                                                      {"AND", AND},
-                                                      {"OR", OR},
-                                                      {"method", METHOD},
-                                                      {"return", RETURN},
-                                                      {"loop", LOOP},
-                                                      {"from", FROM},
-                                                      {"to", TO},
-                                                      {"while", WHILE},
-                                                      {"until", UNTIL},
-                                                      {"if", IF},
-                                                      {"else", ELSE},
-                                                      {"then", THEN},
-                                                      {"end", END},
-                                                      {"output", OUTPUT},
-                                                      {"input", INPUT},
-                                                      {"length", LENGTH},
-                                                      {"getNext", GET_NEXT},
-                                                      {"hasNext", HAS_NEXT},
-                                                      {"push", PUSH},
-                                                      {"pop", POP},
-                                                      {"enqueue", ENQUEUE},
-                                                      {"dequeue", DEQUEUE},
-                                                      {"isEmpty", IS_EMPTY},
-                                                      {"Array", NEW_ARR},
-                                                      {"Stack", NEW_STACK},
-                                                      {"Queue", NEW_QUEUE}};
-
-int lookup_keyword(std::string lexeme);
+// a token as a range of the source of the lexer, see lxr::Lexer::next_span
+struct Span {
+  std::uint32_t offset{0};
+  std::uint32_t length{0};
+  int id{END_FILE};
+  int num_type{FLOAT};
+  unsigned line{0};
+};
+
+struct Keyword {
+  std::string_view lexeme;
+  int id;
+};
+
+constexpr Keyword RESERVED_KEYWORDS[] = {
+    {"div", DIV_WQ}, {"mod", MOD}, {"AND", AND}, {"OR", OR},
+    {"method", METHOD}, {"return", RETURN}, {"loop", LOOP}, {"from", FROM},
+    {"to", TO}, {"while", WHILE}, {"until", UNTIL}, {"if", IF}, {"else", ELSE},
+    {"then", THEN}, {"end", END}, {"output", OUTPUT}, {"input", INPUT},
+    {"length", LENGTH}, {"getNext", GET_NEXT}, {"hasNext", HAS_NEXT},
+    {"push", PUSH}, {"pop", POP}, {"enqueue", ENQUEUE}, {"dequeue", DEQUEUE},
+    {"isEmpty", IS_EMPTY}, {"Array", NEW_ARR}, {"Stack", NEW_STACK},
+    {"Queue", NEW_QUEUE}};
+
+// Keywords are found through a perfect hash: FNV-1a started from a seed that
+// is searched for at compile time until every keyword lands in its own slot.
+constexpr std::size_t KEYWORD_SLOTS = 128;
+
+constexpr std::uint32_t keyword_hash(std::string_view lexeme,
+                                     std::uint32_t seed) {
+  std::uint32_t hash = seed;
+  for (char c : lexeme) hash = (hash ^ (unsigned char)c) * 16777619u;
+  return hash % KEYWORD_SLOTS;
+}
+
+constexpr bool keyword_seed_fits(std::uint32_t seed) {
+  bool used[KEYWORD_SLOTS] = {};
+  for (auto &keyword : RESERVED_KEYWORDS) {
+    std::uint32_t slot = keyword_hash(keyword.lexeme, seed);
+    if (used[slot]) return false;
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr std::uint32_t keyword_seed() {
+  std::uint32_t seed = 2166136261u;
+  while (!keyword_seed_fits(seed)) ++seed;
+  return seed;
+}
+
+constexpr std::uint32_t KEYWORD_SEED = keyword_seed();
+
+// index + 1 of the keyword in each slot, 0 for empty slots
+constexpr std::array<std::uint8_t, KEYWORD_SLOTS> keyword_table() {
+  std::array<std::uint8_t, KEYWORD_SLOTS> table{};
+  for (std::size_t i = 0; i < std::size(RESERVED_KEYWORDS); ++i)
+    table[keyword_hash(RESERVED_KEYWORDS[i].lexeme, KEYWORD_SEED)] = i + 1;
+  return table;
+}
+
+constexpr std::array<std::uint8_t, KEYWORD_SLOTS> KEYWORD_TABLE =
+    keyword_table();
+
+constexpr std::size_t max_keyword_length() {
+  std::size_t length = 0;
+  for (auto &keyword : RESERVED_KEYWORDS)
+    length = std::max(length, keyword.lexeme.size());
+  return length;
+}
+
+constexpr std::size_t MAX_KEYWORD_LENGTH = max_keyword_length();
+
+// id of the keyword spelled by lexeme, 0 if it is not one
+constexpr int lookup_keyword(std::string_view lexeme) {
+  if (lexeme.size() > MAX_KEYWORD_LENGTH) return 0;
+  std::uint8_t entry = KEYWORD_TABLE[keyword_hash(lexeme, KEYWORD_SEED)];
+  if (entry == 0 || RESERVED_KEYWORDS[entry - 1].lexeme != lexeme) return 0;
+  return RESERVED_KEYWORDS[entry - 1].id;
+}
+
+static_assert(lookup_keyword("isEmpty") == IS_EMPTY &&
+                  lookup_keyword("Queue") == NEW_QUEUE &&
+                  lookup_keyword("Q") == 0,
+              "keyword table is not a perfect hash");
 
 void print_token(Token *token);
 
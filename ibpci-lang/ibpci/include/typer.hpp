@@ -0,0 +1,71 @@
+#ifndef TYPER_HPP
+#define TYPER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+#include "resolver.hpp"
+#include "token.hpp"
+
+namespace ty {
+
+// the kinds of value an expression may have, one bit each; TEXT are strings
+// whose token id is not tk::STRING, which only come from input()
+enum type_bit : std::uint8_t {
+  NUM = 1,
+  STRING = 2,
+  TEXT = 4,
+  ARR = 8,
+  STACK = 16,
+  QUEUE = 32,
+  VOID = 64,
+  UNDEFINED = 128
+};
+
+typedef std::uint8_t types;
+
+// whatever a method or a container may hand back
+const types ANY = NUM | STRING | TEXT | ARR | STACK | QUEUE | VOID;
+
+// the variables of one scope, by slot
+typedef std::vector<types> env;
+
+// Flow-sensitive inference of the kinds of values of a resolved program.
+// Every variable of a scope gets the set of kinds it may hold at each point,
+// loops are gone through until their sets stop growing. The BINOP and CMP
+// nodes whose operands are provably numbers or provably strings are turned
+// into the variants the tree walker runs without type checks. An operation
+// whose operands can only have kinds it rejects is left as it is, it fails
+// at run time if it is ever reached. Method bodies that are not parsed yet
+// are typed once they are, with specialize(method).
+class Typer {
+ private:
+  ast::Tree &tree;
+  rsv::scopes &scopes;
+  env vars;
+  // nodes are specialized on the last pass through a loop only, the sets of
+  // the passes before are not final
+  bool final{true};
+
+  void method(ast::node root);
+  void stmt(ast::node root);
+  void block(ast::node root);
+  void loop(ast::node cond, ast::node body);
+  void condition(ast::node root);
+  void comparison(ast::node root);
+  types expr(ast::node root);
+  types binop(ast::node root);
+  types read(ast::node leaf);
+  types std_return(ast::node root);
+  void exprs(ast::node root);
+
+ public:
+  Typer(ast::Tree &tree, rsv::scopes &scopes);
+  void specialize();
+  void specialize(ast::node method);
+};
+
+}  // namespace ty
+
+#endif
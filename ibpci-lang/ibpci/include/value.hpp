@@ -0,0 +1,326 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "token.hpp"
+
+namespace val {
+
+// INT and NUM are both the NUM of the language, NUM holds the fractional ones
+enum value_kind : std::uint8_t {
+  UNDEFINED,
+  VOID,
+  INT,
+  NUM,
+  STR,
+  ARR,
+  STACK,
+  QUEUE
+};
+
+class Object {
+ public:
+  unsigned refs{1};
+  Object() = default;
+  // a copy starts out unshared
+  Object(const Object &) {}
+  virtual ~Object() = default;
+  virtual Object *clone() = 0;
+};
+
+// 16 byte runtime value; numbers are stored inline, everything else lives in
+// a reference counted Object
+class Value {
+ public:
+  value_kind kind;
+  union {
+    std::int64_t i;
+    double num;
+    Object *obj;
+  };
+
+  Value() : kind(UNDEFINED), i(0) {}
+  explicit Value(std::int64_t n) : kind(INT), i(n) {}
+  explicit Value(double n) : kind(NUM), num(n) {}
+  explicit Value(value_kind k) : kind(k), i(0) {}
+  Value(value_kind k, Object *o) : kind(k), obj(o) {}
+  explicit Value(std::string str, int id = tk::STRING);
+
+  Value(const Value &v) : kind(v.kind) {
+    if (v.is_object()) {
+      obj = v.obj;
+      obj->refs++;
+    } else {
+      i = v.i;
+    }
+  }
+
+  Value(Value &&v) noexcept : kind(v.kind) {
+    if (v.is_object())
+      obj = v.obj;
+    else
+      i = v.i;
+    v.kind = UNDEFINED;
+  }
+
+  Value &operator=(const Value &v) {
+    if (v.is_object()) v.obj->refs++;
+    release();
+    kind = v.kind;
+    if (is_object())
+      obj = v.obj;
+    else
+      i = v.i;
+    return *this;
+  }
+
+  Value &operator=(Value &&v) noexcept {
+    if (this != &v) {
+      release();
+      kind = v.kind;
+      if (is_object())
+        obj = v.obj;
+      else
+        i = v.i;
+      v.kind = UNDEFINED;
+    }
+    return *this;
+  }
+
+  ~Value() { release(); }
+
+  bool is_number() const { return kind == INT || kind == NUM; }
+  bool is_object() const { return kind >= STR; }
+  bool is_container() const { return kind >= ARR; }
+  // containers are shared between values until one of them is mutated, every
+  // mutation goes through a detach() first
+  void detach() {
+    if (is_container() && obj->refs > 1) copy();
+  }
+  int type_id() const;
+  bool same_type(const Value &v) const;
+  std::string type_name() const;
+  const std::string &str() const;
+  void print() const;
+
+ private:
+  void copy();
+  void release() {
+    if (is_object() && --obj->refs == 0) delete obj;
+  }
+};
+
+class String : public Object {
+ public:
+  // id of the token the string was lexed as, input() may produce identifiers
+  int id;
+  std::string str;
+  String(std::string str, int id) : id(id), str(std::move(str)) {}
+  Object *clone() override;
+};
+
+// allocates with calloc and leaves value initialized elements alone, a newly
+// sized buffer stays untouched zero pages until it is written to
+template <typename T>
+struct ZeroAllocator {
+  typedef T value_type;
+  ZeroAllocator() = default;
+  template <typename U>
+  ZeroAllocator(const ZeroAllocator<U> &) {}
+  T *allocate(std::size_t n) {
+    void *p = std::calloc(n, sizeof(T));
+    if (p == nullptr) throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+  void deallocate(T *p, std::size_t) { std::free(p); }
+  template <typename U>
+  void construct(U *) {}
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+  template <typename U>
+  bool operator==(const ZeroAllocator<U> &) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const ZeroAllocator<U> &) const {
+    return false;
+  }
+};
+
+typedef std::vector<std::int64_t, ZeroAllocator<std::int64_t>> int_buffer;
+typedef std::vector<double, ZeroAllocator<double>> num_buffer;
+
+// arrays keep their elements unboxed in ints while they only hold integers and
+// in nums while they only hold numbers, any other element moves all of them
+// into values for good
+class Array : public Object {
+ public:
+  enum storage : std::uint8_t { INTS, NUMS, VALUES };
+  std::vector<unsigned> dims;
+  int_buffer ints;
+  num_buffer nums;
+  std::vector<Value> values;
+  storage kind{INTS};
+
+  std::size_t size() const {
+    switch (kind) {
+      case INTS:
+        return ints.size();
+      case NUMS:
+        return nums.size();
+      default:
+        return values.size();
+    }
+  }
+  Value get(std::size_t i) const {
+    switch (kind) {
+      case INTS:
+        return Value(ints[i]);
+      case NUMS:
+        return Value(nums[i]);
+      default:
+        return values[i];
+    }
+  }
+  void set(std::size_t i, Value v) {
+    if (kind == INTS && v.kind == INT)
+      ints[i] = v.i;
+    else if (kind == NUMS && v.kind == NUM)
+      nums[i] = v.num;
+    else
+      widen_set(i, std::move(v));
+  }
+  void push(Value v);
+  void zeros(std::size_t count);
+  void print() const;
+  Object *clone() override;
+
+ private:
+  void widen(const Value &v);
+  void widen_set(std::size_t i, Value v);
+};
+
+// growable ring buffer, the backing store of both stacks and queues
+class Sequence : public Object {
+ public:
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  const Value &front() const { return buffer[head]; }
+  const Value &back() const { return buffer[(head + count - 1) & mask()]; }
+  void push_back(Value v) {
+    if (count == buffer.size()) grow();
+    buffer[(head + count++) & mask()] = std::move(v);
+  }
+  Value pop_front() {
+    Value out = std::move(buffer[head]);
+    head = (head + 1) & mask();
+    --count;
+    return out;
+  }
+  Value pop_back() {
+    --count;
+    return std::move(buffer[(head + count) & mask()]);
+  }
+  void print() const;
+
+ private:
+  // the capacity is always a power of two
+  std::vector<Value> buffer;
+  std::size_t head{0};
+  std::size_t count{0};
+  std::size_t mask() const { return buffer.size() - 1; }
+  void grow();
+};
+
+// pop() and getNext() take the element pushed first
+class Stack : public Sequence {
+ public:
+  void push(Value v) { push_back(std::move(v)); }
+  Value pop() { return pop_front(); }
+  const Value &next() const { return front(); }
+  Object *clone() override;
+};
+
+// dequeue() and getNext() take the element enqueued last
+class Queue : public Sequence {
+ public:
+  void enqueue(Value v) { push_back(std::move(v)); }
+  Value dequeue() { return pop_back(); }
+  const Value &next() const { return back(); }
+  Object *clone() override;
+};
+
+inline Array *as_array(const Value &v) { return static_cast<Array *>(v.obj); }
+
+inline Sequence *as_sequence(const Value &v) {
+  return static_cast<Sequence *>(v.obj);
+}
+
+inline Stack *as_stack(const Value &v) { return static_cast<Stack *>(v.obj); }
+
+inline Queue *as_queue(const Value &v) { return static_cast<Queue *>(v.obj); }
+
+std::int64_t length(const Value &v);
+
+inline double to_double(const Value &v) {
+  return v.kind == INT ? (double)v.i : v.num;
+}
+
+// integer part of a number, as used for indices, bounds, 'div' and 'mod';
+// numbers beyond the 64 bit range saturate and NaN is 0
+inline std::int64_t to_int(const Value &v) {
+  if (v.kind == INT) return v.i;
+  if (v.num >= 9223372036854775808.0) return INT64_MAX;
+  if (v.num < -9223372036854775808.0) return INT64_MIN;
+  return v.num == v.num ? (std::int64_t)v.num : 0;
+}
+
+// value of a NUM token, integer literals become INT values
+Value number(double num, int num_type);
+Value number(const tk::Token &token);
+
+// arithmetic on two numbers, integers stay integers unless the result is
+// fractional or does not fit into 64 bits; the divisor is checked by the
+// caller
+inline Value add(const Value &l, const Value &r) {
+  std::int64_t out;
+  if (l.kind == INT && r.kind == INT && !__builtin_add_overflow(l.i, r.i, &out))
+    return Value(out);
+  return Value(to_double(l) + to_double(r));
+}
+
+inline Value subtract(const Value &l, const Value &r) {
+  std::int64_t out;
+  if (l.kind == INT && r.kind == INT && !__builtin_sub_overflow(l.i, r.i, &out))
+    return Value(out);
+  return Value(to_double(l) - to_double(r));
+}
+
+inline Value multiply(const Value &l, const Value &r) {
+  std::int64_t out;
+  if (l.kind == INT && r.kind == INT && !__builtin_mul_overflow(l.i, r.i, &out))
+    return Value(out);
+  return Value(to_double(l) * to_double(r));
+}
+
+Value divide(const Value &l, const Value &r);
+Value divide_int(const Value &l, const Value &r);
+Value modulo(const Value &l, const Value &r);
+Value negate(const Value &v);
+
+// comparison of two numbers, op is one of tk::LT, GT, LEQ, GEQ, DNEQ, IS
+bool compare(const Value &l, const Value &r, int op);
+
+}  // namespace val
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "lexer.hpp"
+#include "token.hpp"
+#include "value.hpp"
+
+namespace IBPCI {
+
+struct Frame {
+  const bc::Chunk *chunk;
+  const bc::Instr *ip;
+  std::size_t base;
+};
+
+class VM {
+ private:
+  bc::Program &program;
+  std::vector<val::Value> stack;
+  std::vector<Frame> frames;
+  // index of the method each name is bound to, -1 until it is declared
+  std::vector<int> methods;
+
+  void error(std::string message, int kind, unsigned line);
+  void error_uref(const bc::Chunk *chunk, unsigned slot, unsigned line);
+  void reserve(std::size_t size);
+  void arith(val::Value *l, val::Value *r, int op, unsigned line);
+  void compare(val::Value *l, val::Value *r, int op, unsigned line);
+  std::size_t compute_key(val::Value &arr, val::Value *keys, unsigned count,
+                          unsigned line);
+  val::Value declare_empty_array(val::Value *dims, unsigned count,
+                                 unsigned line);
+  val::Value input(unsigned prompt, unsigned line);
+
+ public:
+  VM(bc::Program &program);
+  void run();
+};
+
+}  // namespace IBPCI
+
+#endif
@@ -2,19 +2,24 @@
 
 namespace ar {
 
-AR::AR(std::string name, ast::AST *root) {
-  this->name = name;
+AR::AR(const rsv::Scope *scope, ast::node root) {
+  this->scope = scope;
   this->root = root;
+  contents.resize(scope->locals.size());
 }
 
-void AR::error_uref(std::string key, ast::AST *leaf) {
-  std::cout << "RUN-TIME error at line " << leaf->token.line
-            << ": undefined reference to variable " << key << std::endl;
+// the streaming resolver adds variables to main while it runs
+void AR::grow() { contents.resize(scope->locals.size()); }
+
+void AR::error_uref(unsigned slot, unsigned line) {
+  std::cout << "RUN-TIME error at line " << line
+            << ": undefined reference to variable " << scope->locals[slot]
+            << std::endl;
   exit(1);
 }
 
-void AR::error_itp(std::string key, int type, ast::AST *leaf) {
-  std::cout << "RUN-TIME error at line " << leaf->token.line << ": variable "
+void AR::error_itp(std::string key, int type, unsigned line) {
+  std::cout << "RUN-TIME error at line " << line << ": variable "
             << key << " is of incompatible type " << ast::id_to_str(type)
             << ", should be "
             << ast::id_to_str(type == ast::NUM ? ast::STRING : ast::NUM)
@@ -22,55 +27,30 @@ void AR::error_itp(std::string key, int type, ast::AST *leaf) {
   exit(1);
 }
 
-void AR::insert(std::string key, ast::AST *root) {
-  if (contents.find(key) == contents.end()) {
-    contents[key] = std::make_unique<rf::Reference>(root);
-  } else {
-    contents[key].get()->set_value(root);
-  }
-}
-
-void AR::insert(std::string key, tk::Token *terminal) {
-  if (contents.find(key) == contents.end()) {
-    contents[key] = std::make_unique<rf::Reference>(terminal);
-  } else {
-    contents[key].get()->set_value(terminal);
-  }
+void AR::insert(unsigned slot, val::Value value) {
+  contents[slot] = std::move(value);
 }
 
-void AR::insert(std::string key, rf::Reference *terminal) {
-  if (contents.find(key) == contents.end()) {
-    contents[key] = std::make_unique<rf::Reference>(terminal);
-  } else {
-    contents[key].get()->set_value(terminal);
-  }
-}
-
-void AR::mutate_array(std::string key, unsigned address,
-                      rf::Reference *terminal) {
-  if (contents.find(key) != contents.end()) {
-    contents[key].get()->mutate_array(address, terminal);
-  } else {
-    exit(1);
-  }
+void AR::mutate_array(unsigned slot, unsigned address, val::Value value) {
+  contents[slot].detach();
+  val::as_array(contents[slot])->set(address, std::move(value));
 }
 
-ast::AST *AR::lookup_root() { return root; }
+ast::node AR::lookup_root() { return root; }
 
-std::string AR::lookup_name() { return name; }
+std::string AR::lookup_name() { return scope->name; }
 
-rf::Reference *AR::lookup(std::string key, ast::AST *leaf) {
-  data::iterator it = contents.find(key);
-  if (it != contents.end()) return it->second.get();
-  error_uref(key, leaf);
-  return nullptr;
+val::Value &AR::lookup(unsigned slot, unsigned line) {
+  if (contents[slot].kind == val::UNDEFINED) error_uref(slot, line);
+  return contents[slot];
 }
 
 void AR::print() {
-  std::cout << name << "\n======================================\n";
-  for (auto &a : contents) {
-    std::cout << a.first << " : ";
-    a.second.get()->print();
+  std::cout << scope->name << "\n======================================\n";
+  for (unsigned i = 0; i < contents.size(); ++i) {
+    if (contents[i].kind == val::UNDEFINED) continue;
+    std::cout << scope->locals[i] << " : ";
+    contents[i].print();
     std::cout << std::endl;
   }
 }
@@ -2,39 +2,56 @@
 
 namespace ast {
 
-AST::AST(tk::Token &token, int node_id) : token(token) {
-  id = node_id;
-  is_terminal = true;
+// rebuilds the token the node was made from
+tk::Token Tree::token(node n) const {
+  const Node &x = nodes[n];
+  tk::Token out;
+  out.id = x.token;
+  out.line = x.line;
+  if (x.token == tk::NUM) {
+    out.val_num = numbers[x.payload];
+    out.num_type = x.num_type;
+  } else if (x.token >= tk::PLUS && x.token <= tk::COMMA) {
+    out.op = x.token;
+  } else {
+    out.val_str = strings[x.payload];
+  }
+  return out;
+}
+
+node Tree::add(int id) {
+  nodes.push_back({(std::uint8_t)id, 0, 0, false, 0, 0, 0, 0, -1});
+  return nodes.size() - 1;
 }
 
-AST::AST(int node_id) {
-  id = node_id;
-  is_terminal = false;
+node Tree::add(int id, const tk::Span &token, std::uint32_t payload) {
+  nodes.push_back({(std::uint8_t)id, (std::uint8_t)token.id,
+                   (std::uint8_t)token.num_type, true, token.line, 0, 0,
+                   payload, -1});
+  return nodes.size() - 1;
 }
 
-void AST::push_child(AST *child) { children.push_back(child); }
+void Tree::close(node n, const node *children, std::uint32_t count) {
+  nodes[n].first = kids.size();
+  nodes[n].count = count;
+  kids.insert(kids.end(), children, children + count);
+  if (!nodes[n].is_terminal && count > 0 && children[0] != NONE)
+    nodes[n].line = nodes[children[0]].line;
+}
 
-void print_tree(AST *root, int offset) {
-  if (root == NULL) return;
+void print_tree(const Tree &tree, node root, int offset) {
+  if (root == NONE) return;
   std::cout << std::setw(offset);
   std::cout << "\u2560";
   std::cout << "\u2550\u2550[";
-  if (root->is_terminal)
-    root->token.print();
+  if (tree[root].is_terminal)
+    tree.token(root).print();
   else
-    std::cout << id_to_str(root->id);
+    std::cout << id_to_str(tree[root].id);
   std::cout << "]\n";
-  for (auto *a : root->children) {
-    print_tree(a, offset + 4);
-  }
-}
-
-void delete_tree(AST *root) {
-  if (root == NULL) return;
-  for (auto *a : root->children) {
-    delete_tree(a);
+  for (auto a : tree.children(root)) {
+    print_tree(tree, a, offset + 4);
   }
-  delete root;
 }
 
 std::string id_to_str(int id) {
@@ -127,6 +144,21 @@ std::string id_to_str(int id) {
     case OUTPUT:
       out = "output";
       return out;
+    case ERROR:
+      out = "error";
+      return out;
+    case NUM_BINOP:
+      out = "num binop";
+      return out;
+    case STR_CONCAT:
+      out = "str concat";
+      return out;
+    case NUM_CMP:
+      out = "num cmp";
+      return out;
+    case STR_CMP:
+      out = "str cmp";
+      return out;
   }
   return 0;
 }
@@ -0,0 +1,128 @@
+#include "../include/ast_image.hpp"
+
+namespace ast {
+
+namespace {
+
+const char MAGIC[4] = {'I', 'B', 'C', 'I'};
+const std::uint32_t ORDER_MARK = 0x01020304;
+
+template <typename T>
+void append(std::string &out, const T *items, std::size_t count) {
+  out.append(reinterpret_cast<const char *>(items), count * sizeof(T));
+}
+
+// copies count items off the front of the image, which is long enough
+template <typename T>
+void take(std::string_view &image, T *items, std::size_t count) {
+  if (count > 0) std::memcpy(items, image.data(), count * sizeof(T));
+  image.remove_prefix(count * sizeof(T));
+}
+
+// every index in the tree points into its buffers
+bool consistent(const Tree &tree) {
+  if (tree.root >= tree.nodes.size()) return false;
+  for (auto kid : tree.kids)
+    if (kid != NONE && kid >= tree.nodes.size()) return false;
+  for (auto &x : tree.nodes) {
+    if (x.id > ERROR || x.first > tree.kids.size() ||
+        x.count > tree.kids.size() - x.first)
+      return false;
+    if (!x.is_terminal) continue;
+    if (x.token == tk::NUM) {
+      if (x.payload >= tree.numbers.size()) return false;
+    } else if (x.token < tk::PLUS || x.token > tk::COMMA) {
+      if (x.payload >= tree.strings.size()) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::uint64_t hash_bytes(std::string_view bytes) {
+  const std::uint64_t prime = 1099511628211ull;
+  std::uint64_t hash = 14695981039346656037ull;
+  std::size_t i = 0;
+  for (; i + 8 <= bytes.size(); i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes.data() + i, 8);
+    hash = (hash ^ word) * prime;
+  }
+  for (; i < bytes.size(); ++i) hash = (hash ^ (unsigned char)bytes[i]) * prime;
+  return hash;
+}
+
+std::string write_image(const Tree &tree, std::uint64_t source_hash) {
+  ImageHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = IMAGE_VERSION;
+  header.node_size = sizeof(Node);
+  header.byte_order = ORDER_MARK;
+  header.source_hash = source_hash;
+  header.root = tree.root;
+  header.nodes = tree.nodes.size();
+  header.kids = tree.kids.size();
+  header.numbers = tree.numbers.size();
+  header.strings = tree.strings.size();
+
+  std::string image(sizeof(header), '\0');
+  append(image, tree.nodes.data(), tree.nodes.size());
+  append(image, tree.kids.data(), tree.kids.size());
+  append(image, tree.numbers.data(), tree.numbers.size());
+  for (auto &a : tree.strings) {
+    std::uint32_t length = a.size();
+    append(image, &length, 1);
+  }
+  for (auto &a : tree.strings) {
+    image += a;
+    header.string_bytes += a.size();
+  }
+  std::string_view body = image;
+  header.checksum = hash_bytes(body.substr(sizeof(header)));
+  std::memcpy(&image[0], &header, sizeof(header));
+  return image;
+}
+
+Tree *read_image(std::string_view image, std::uint64_t source_hash) {
+  ImageHeader header;
+  if (image.size() < sizeof(header)) return nullptr;
+  take(image, &header, 1);
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != IMAGE_VERSION || header.node_size != sizeof(Node) ||
+      header.byte_order != ORDER_MARK || header.source_hash != source_hash ||
+      header.checksum != hash_bytes(image))
+    return nullptr;
+  std::uint64_t size = (std::uint64_t)header.nodes * sizeof(Node) +
+                       header.kids * sizeof(node) +
+                       header.numbers * sizeof(double) +
+                       header.strings * sizeof(std::uint32_t) +
+                       header.string_bytes;
+  if (size != image.size()) return nullptr;
+
+  Tree *tree = new Tree;
+  tree->root = header.root;
+  tree->nodes.resize(header.nodes);
+  tree->kids.resize(header.kids);
+  tree->numbers.resize(header.numbers);
+  std::vector<std::uint32_t> lengths(header.strings);
+  take(image, tree->nodes.data(), header.nodes);
+  take(image, tree->kids.data(), header.kids);
+  take(image, tree->numbers.data(), header.numbers);
+  take(image, lengths.data(), header.strings);
+  bool read = true;
+  for (std::size_t i = 0; read && i < lengths.size(); ++i) {
+    read = lengths[i] <= image.size();
+    if (read) {
+      tree->strings.emplace_back(image.substr(0, lengths[i]));
+      image.remove_prefix(lengths[i]);
+    }
+  }
+  if (!read || !image.empty() || !consistent(*tree)) {
+    delete tree;
+    return nullptr;
+  }
+  return tree;
+}
+
+}  // namespace ast
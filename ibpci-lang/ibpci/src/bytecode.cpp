@@ -0,0 +1,72 @@
+#include "../include/bytecode.hpp"
+
+namespace bc {
+
+const char *OP_NAMES[] = {
+    "CONST", "LOAD", "STORE", "LOAD_ELEM", "STORE_ELEM", "DISCARD", "ADD",
+    "SUB", "MUL", "DIV", "DIV_INT", "MOD", "NEG", "LT", "GT", "LEQ", "GEQ",
+    "DNEQ", "IS", "JUMP", "JUMP_IF_FALSE", "JUMP_IF_TRUE", "FOR_INIT",
+    "FOR_ITER", "FOR_NEXT", "DECLARE", "CALL", "RETURN", "RETURN_VOID",
+    "NEW_ARR", "MAKE_ARR", "NEW_STACK", "NEW_QUEUE", "PUSH", "ENQUEUE",
+    "LENGTH", "POP", "DEQUEUE", "GET_NEXT", "HAS_NEXT", "IS_EMPTY", "PRINT",
+    "PRINT_NL", "INPUT", "ERROR", "HALT"};
+
+std::string op_to_str(int op) {
+  if (op < 0 || op > HALT) return "NULL";
+  return OP_NAMES[op];
+}
+
+void print_chunk(Program &program, Chunk &chunk) {
+  std::cout << chunk.name << " (params: " << chunk.params
+            << ", locals: " << chunk.locals.size()
+            << ", stack: " << chunk.max_stack << ")\n";
+  for (unsigned i = 0; i < chunk.code.size(); ++i) {
+    Instr &in = chunk.code[i];
+    std::cout << std::setw(6) << i << std::setw(6) << chunk.lines[i] << "  "
+              << std::left << std::setw(14) << op_to_str(in.op) << std::right
+              << std::setw(6) << in.a << std::setw(6) << in.b;
+    switch (in.op) {
+      case CONST:
+        std::cout << "  ; ";
+        program.constants[in.a].print();
+        break;
+      case LOAD:
+      case STORE:
+      case LOAD_ELEM:
+      case STORE_ELEM:
+      case PUSH:
+      case ENQUEUE:
+      case LENGTH:
+      case POP:
+      case DEQUEUE:
+      case GET_NEXT:
+      case HAS_NEXT:
+      case IS_EMPTY:
+        std::cout << "  ; " << chunk.locals[in.a];
+        break;
+      case CALL:
+        std::cout << "  ; " << program.method_names[in.a];
+        break;
+      case DECLARE:
+        std::cout << "  ; " << program.methods[in.a].name;
+        break;
+      case INPUT:
+      case ERROR:
+        std::cout << "  ; " << program.strings[in.a];
+        break;
+      default:
+        break;
+    }
+    std::cout << "\n";
+  }
+  std::cout << std::endl;
+}
+
+void print_program(Program &program) {
+  print_chunk(program, program.main);
+  for (auto &a : program.methods) {
+    print_chunk(program, a);
+  }
+}
+
+}  // namespace bc
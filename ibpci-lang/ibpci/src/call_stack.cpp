@@ -2,8 +2,8 @@
 
 namespace cstk {
 
-CallStack::CallStack(ast::AST *tree, bool log) {
-  call_stack.push(std::make_unique<ar::AR>("main", tree));
+CallStack::CallStack(ast::node root, const rsv::Scope *scope, bool log) {
+  call_stack.push(std::make_unique<ar::AR>(scope, root));
   log_stack = log;
 }
 
@@ -12,31 +12,28 @@ void CallStack::pop() {
   if (log_stack) print(false);
 }
 
-void CallStack::push_AR(std::string name, ast::AST *root) {
-  call_stack.push(std::make_unique<ar::AR>(name, root));
+void CallStack::push_AR(const rsv::Scope *scope, ast::node root) {
+  call_stack.push(std::make_unique<ar::AR>(scope, root));
 }
 
-void CallStack::push(std::string key, tk::Token *terminal) {
-  call_stack.top().get()->insert(key, terminal);
-}
+void CallStack::grow() { call_stack.top()->grow(); }
 
-void CallStack::push(std::string key, rf::Reference *terminal) {
-  call_stack.top().get()->insert(key, terminal);
+void CallStack::push(unsigned slot, val::Value value) {
+  call_stack.top().get()->insert(slot, std::move(value));
 }
 
-void CallStack::push(std::string key, unsigned address,
-                     rf::Reference *terminal) {
-  call_stack.top().get()->mutate_array(key, address, terminal);
+void CallStack::push(unsigned slot, unsigned address, val::Value value) {
+  call_stack.top().get()->mutate_array(slot, address, std::move(value));
 }
 
-ast::AST *CallStack::peek_for_root() { return call_stack.top()->lookup_root(); }
+ast::node CallStack::peek_for_root() { return call_stack.top()->lookup_root(); }
 
 std::string CallStack::peek_for_name() {
   return call_stack.top().get()->lookup_name();
 }
 
-rf::Reference *CallStack::peek(std::string key, ast::AST *leaf) {
-  return call_stack.top().get()->lookup(key, leaf);
+val::Value &CallStack::peek(unsigned slot, unsigned line) {
+  return call_stack.top().get()->lookup(slot, line);
 }
 
 bool CallStack::empty() { return call_stack.empty(); }
@@ -0,0 +1,733 @@
+#include "../include/closure.hpp"
+
+namespace IBPCI {
+
+namespace {
+
+template <int op, typename T>
+bool compare_as(T l, T r) {
+  switch (op) {
+    case tk::LT:
+      return l < r;
+    case tk::GT:
+      return l > r;
+    case tk::LEQ:
+      return l <= r;
+    case tk::GEQ:
+      return l >= r;
+    case tk::DNEQ:
+      return l != r;
+    default:
+      return l == r;
+  }
+}
+
+}  // namespace
+
+ClosureEngine::ClosureEngine(ast::Tree &tree, rsv::scopes &scopes)
+    : tree(tree), scopes(scopes) {
+  call_stack =
+      cstk::CallStack(tree.root, &scopes[tree[tree.root].slot], false);
+  for (auto a : tree.children(tree.root)) {
+    stmt built = statement(a);
+    if (built) main.push_back(std::move(built));
+  }
+  declared.assign(method_ids.size(), nullptr);
+}
+
+void ClosureEngine::run() {
+  for (auto &a : main) {
+    a();
+  }
+}
+
+void ClosureEngine::error(std::string message, unsigned line) {
+  std::cout << "SEMANTIC ERROR at line " << line << ": " << message
+            << std::endl;
+  exit(1);
+}
+
+void ClosureEngine::error_rt(std::string message, unsigned line) {
+  std::cout << "RUN-TIME error at line " << line << ": " << message
+            << std::endl;
+  exit(1);
+}
+
+unsigned ClosureEngine::method_id(const std::string &name) {
+  return method_ids.emplace(name, method_ids.size()).first->second;
+}
+
+// returns an undefined value unless the block ends in a return
+val::Value ClosureEngine::run(const Block &block) {
+  for (auto &a : block.stmts) {
+    a();
+  }
+  return block.ret ? block.ret() : val::Value();
+}
+
+// Literals and variables are handed to make as they are read, anything else
+// as the closure computing it. make has to return the same type for all of
+// them.
+template <typename F>
+auto ClosureEngine::with_operand(ast::node root, F make) {
+  switch (tree[root].id) {
+    case ast::NUM:
+      return make(Constant{val::number(tree.num(root), tree[root].num_type)});
+    case ast::STRING:
+      return make(Constant{val::Value(tree.str(root))});
+    case ast::ID:
+      return make(Variable{(unsigned)tree[root].slot, tree[root].line});
+    default:
+      return make(Computed{compute(root)});
+  }
+}
+
+// expressions never assign to variables, reading one in place is reading it
+// before the other operand is computed
+template <int op>
+ClosureEngine::expr ClosureEngine::binop(ast::node root) {
+  unsigned line = tree[root].line;
+  return with_operand(tree.child(root, 0), [&](auto l) {
+    return with_operand(tree.child(root, 1), [&](auto r) -> expr {
+      return [this, l, r, line]() {
+        const val::Value &a = l(this);
+        const val::Value &b = r(this);
+        return arith<op>(a, b, line);
+      };
+    });
+  });
+}
+
+template <int op>
+ClosureEngine::cond ClosureEngine::comparison(ast::node root) {
+  unsigned line = tree[root].line;
+  return with_operand(tree.child(root, 0), [&](auto l) {
+    return with_operand(tree.child(root, 1), [&](auto r) -> cond {
+      return [this, l, r, line]() {
+        const val::Value &a = l(this);
+        const val::Value &b = r(this);
+        return compare<op>(a, b, line);
+      };
+    });
+  });
+}
+
+template <int op>
+val::Value ClosureEngine::arith(const val::Value &l, const val::Value &r,
+                                unsigned line) {
+  if (l.is_number() && r.is_number()) {
+    switch (op) {
+      case tk::PLUS:
+        return val::add(l, r);
+      case tk::MINUS:
+        return val::subtract(l, r);
+      case tk::MULT:
+        return val::multiply(l, r);
+      case tk::DIV_WOQ:
+        if (val::to_double(r) == 0)
+          error_rt("Division by 0 is illegal", line);
+        return val::divide(l, r);
+      case tk::DIV_WQ:
+        if (val::to_int(r) == 0) error_rt("Division by 0 is illegal", line);
+        return val::divide_int(l, r);
+      default:
+        if (val::to_int(r) == 0) error_rt("Division by 0 is illegal", line);
+        return val::modulo(l, r);
+    }
+  }
+  if (!l.same_type(r))
+    error_rt("Incompatible types: " + l.type_name() + " and " + r.type_name(),
+             line);
+  if (l.kind == val::STR) {
+    if (op != tk::PLUS)
+      error_rt("cannot make this type of comparison on strings", line);
+    return val::Value(l.str() + r.str());
+  }
+  error_rt("cannot make this type of operation on " + l.type_name(), line);
+  return val::Value();
+}
+
+template <int op>
+bool ClosureEngine::compare(const val::Value &l, const val::Value &r,
+                            unsigned line) {
+  if (l.kind == val::INT && r.kind == val::INT)
+    return compare_as<op>(l.i, r.i);
+  if (l.is_number() && r.is_number())
+    return compare_as<op>(val::to_double(l), val::to_double(r));
+  if (!l.same_type(r))
+    error_rt("Incompatible types: " + l.type_name() + " and " + r.type_name(),
+             line);
+  if (l.kind == val::STR) {
+    if (op != tk::IS)
+      error_rt("cannot make this type of comparison on strings", line);
+    return l.str() == r.str();
+  }
+  error_rt("cannot make this type of comparison on " + l.type_name(), line);
+  return false;
+}
+
+// statements main skips are left out
+ClosureEngine::stmt ClosureEngine::statement(ast::node root) {
+  switch (tree[root].id) {
+    case ast::ASSIGN:
+      return assign(root);
+    case ast::STD_VOID:
+      return std_void(root);
+    case ast::IF:
+      return exec_if(root);
+    case ast::WHILE:
+      return exec_whl(root);
+    case ast::FOR:
+      return exec_for(root);
+    case ast::METHOD:
+      return method_decl(root);
+    case ast::METHOD_CALL: {
+      expr call = method_call(root);
+      return [call]() { call(); };
+    }
+    case ast::OUTPUT:
+      return output(root);
+  }
+  return nullptr;
+}
+
+// what follows a return is never run and not built
+ClosureEngine::Block ClosureEngine::block(ast::node root) {
+  Block out;
+  for (auto a : tree.children(root)) {
+    switch (tree[a].id) {
+      case ast::ASSIGN:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::STD_VOID:
+      case ast::FOR:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        out.stmts.push_back(statement(a));
+        break;
+      case ast::RETURN:
+        out.ret = compute(tree.child(a, 0));
+        return out;
+      default:
+        out.stmts.push_back(unexpected(a));
+    }
+  }
+  return out;
+}
+
+ClosureEngine::stmt ClosureEngine::unexpected(ast::node root) {
+  unsigned line = tree[root].line;
+  return [this, line]() { error("Unexpected behavior", line); };
+}
+
+// the body is built with the declaration, the name is bound to it once the
+// declaration runs
+ClosureEngine::stmt ClosureEngine::method_decl(ast::node root) {
+  methods.emplace_back();
+  Method *method = &methods.back();
+  ast::node first = tree.child(root, 0);
+  method->root = root;
+  method->scope = &scopes[tree[root].slot];
+  method->has_params = tree[first].id != ast::BLOCK;
+  if (method->has_params)
+    for (auto a : tree.children(first)) {
+      method->params.push_back(tree[a].slot);
+    }
+  method->body = block(tree.children(root).back());
+  unsigned id = method_id(tree.str(root));
+  unsigned line = tree[root].line;
+  return [this, method, id, line]() {
+    if (declared[id] != nullptr) error("Duplicate method declaration", line);
+    declared[id] = method;
+  };
+}
+
+ClosureEngine::expr ClosureEngine::method_call(ast::node root) {
+  std::vector<expr> args;
+  if (!tree.children(root).empty() &&
+      tree[tree.child(root, 0)].id == ast::PARAM)
+    for (auto a : tree.children(tree.child(root, 0))) {
+      args.push_back(compute(a));
+    }
+  std::string name = tree.str(root);
+  unsigned id = method_id(name);
+  unsigned line = tree[root].line;
+  return [this, args, name, id, line]() {
+    std::vector<val::Value> params;
+    params.reserve(args.size());
+    for (auto &a : args) {
+      params.push_back(a());
+    }
+    const Method *method = declared[id];
+    if (method == nullptr)
+      error("Undefined reference to method " + name, line);
+    DIAGNOSE(DEBUG, RUNTIME, "line " << line << ": calling " << name);
+    call_stack.push_AR(method->scope, method->root);
+    if (method->has_params) {
+      if (params.size() != method->params.size())
+        error("Incorrect number of arguments in the call of function " +
+                  method->scope->name,
+              line);
+      for (unsigned i = 0; i < params.size(); ++i) {
+        call_stack.push(method->params[i], std::move(params[i]));
+      }
+    }
+    val::Value out = run(method->body);
+    call_stack.pop();
+    if (out.kind == val::UNDEFINED) return val::Value(val::VOID);
+    return out;
+  };
+}
+
+// a return in any of the blocks only ends that block
+ClosureEngine::stmt ClosureEngine::exec_if(ast::node root) {
+  std::vector<std::pair<cond, Block>> branches;
+  branches.emplace_back(condition(tree.child(root, 0)),
+                        block(tree.child(root, 1)));
+  for (unsigned i = 2; i < tree.children(root).size(); ++i) {
+    ast::node n = tree.child(root, i);
+    if (tree[n].id == ast::ELIF)
+      branches.emplace_back(condition(tree.child(n, 0)),
+                            block(tree.child(n, 1)));
+    else if (tree[n].id == ast::ELSE)
+      branches.emplace_back(nullptr, block(tree.child(n, 0)));
+  }
+  return [this, branches]() {
+    for (auto &a : branches) {
+      if (!a.first || a.first()) {
+        run(a.second);
+        return;
+      }
+    }
+  };
+}
+
+ClosureEngine::stmt ClosureEngine::exec_whl(ast::node root) {
+  cond test = condition(tree.child(root, 0));
+  Block body = block(tree.child(root, 1));
+  return [this, test, body]() {
+    while (test()) {
+      run(body);
+    }
+  };
+}
+
+ClosureEngine::stmt ClosureEngine::exec_for(ast::node root) {
+  ast::node rng = tree.child(root, 0);
+  unsigned iter = tree[tree.child(rng, 0)].slot;
+  unsigned line = tree[rng].line;
+  expr from = compute(tree.child(rng, 1));
+  expr to = compute(tree.child(rng, 2));
+  Block body = block(tree.child(root, 1));
+  return [this, iter, line, from, to, body]() {
+    val::Value f = from();
+    val::Value t = to();
+    if (!f.is_number() || !t.is_number())
+      error_rt("Incompatible types: " + f.type_name() + " and " +
+                   t.type_name(),
+               line);
+    std::int64_t fr = val::to_int(f);
+    std::int64_t last = val::to_int(t);
+    if (fr < last) {
+      for (; fr <= last; ++fr) {
+        call_stack.push(iter, val::Value(fr));
+        run(body);
+      }
+    } else {
+      for (; fr >= last; --fr) {
+        call_stack.push(iter, val::Value(fr));
+        run(body);
+      }
+    }
+  };
+}
+
+// the value is computed before the indices
+ClosureEngine::stmt ClosureEngine::assign(ast::node root) {
+  ast::node target = tree.child(root, 0);
+  unsigned slot = tree[target].slot;
+  unsigned line = tree[target].line;
+  expr value = compute(tree.child(root, 1));
+  if (tree[target].id != ast::ARR_ACC)
+    return [this, slot, value]() { call_stack.push(slot, value()); };
+  std::string name = tree.str(target);
+  if (tree.children(target).size() == 1)
+    return with_operand(tree.child(target, 0), [&](auto key) -> stmt {
+      return [this, slot, line, name, value, key]() {
+        val::Value in = value();
+        const val::Value &k = key(this);
+        val::Array *arr = lookup_array(slot, line, name);
+        unsigned address = compute_key(arr, &k, 1, line);
+        call_stack.push(slot, address, std::move(in));
+      };
+    });
+  std::vector<expr> keys;
+  for (auto a : tree.children(target)) {
+    keys.push_back(compute(a));
+  }
+  return [this, slot, line, name, value, keys]() {
+    val::Value in = value();
+    std::vector<val::Value> k;
+    for (auto &a : keys) {
+      k.push_back(a());
+    }
+    val::Array *arr = lookup_array(slot, line, name);
+    unsigned address = compute_key(arr, k.data(), k.size(), line);
+    call_stack.push(slot, address, std::move(in));
+  };
+}
+
+ClosureEngine::stmt ClosureEngine::std_void(ast::node root) {
+  ast::node target = tree.child(root, 0);
+  ast::node std_method = tree.children(target).back();
+  if (tree.children(std_method).empty()) return unexpected(std_method);
+  unsigned slot = tree[target].slot;
+  unsigned line = tree[target].line;
+  expr value = compute(tree.child(std_method, 0));
+  switch (tree[std_method].token) {
+    case tk::PUSH:
+      return [this, slot, line, value]() {
+        val::Value in = value();
+        val::Value &ref = call_stack.peek(slot, line);
+        if (ref.kind != val::STACK)
+          error("'push' can only be done on a stack", line);
+        ref.detach();
+        val::as_stack(ref)->push(std::move(in));
+      };
+    case tk::ENQUEUE:
+      return [this, slot, line, value]() {
+        val::Value in = value();
+        val::Value &ref = call_stack.peek(slot, line);
+        if (ref.kind != val::QUEUE)
+          error("'enqueue' can only be done on a queue", line);
+        ref.detach();
+        val::as_queue(ref)->enqueue(std::move(in));
+      };
+  }
+  return []() {};
+}
+
+ClosureEngine::stmt ClosureEngine::output(ast::node root) {
+  std::vector<expr> values;
+  for (auto a : tree.children(root)) {
+    values.push_back(compute(a));
+  }
+  return [values]() {
+    for (auto &a : values) {
+      a().print();
+    }
+    std::cout << std::endl;
+  };
+}
+
+ClosureEngine::expr ClosureEngine::compute(ast::node root) {
+  unsigned slot = tree[root].slot;
+  unsigned line = tree[root].line;
+  switch (tree[root].id) {
+    case ast::NUM: {
+      val::Value constant = val::number(tree.num(root), tree[root].num_type);
+      return [constant]() { return constant; };
+    }
+    case ast::STRING: {
+      val::Value constant(tree.str(root));
+      return [constant]() { return constant; };
+    }
+    case ast::ID:
+      return [this, slot, line]() { return call_stack.peek(slot, line); };
+    case ast::UN_MIN:
+      return negative(root);
+    case ast::STACK:
+      return []() { return val::Value(val::STACK, new val::Stack); };
+    case ast::QUEUE:
+      return []() { return val::Value(val::QUEUE, new val::Queue); };
+    case ast::ARR:
+      return make_array(root);
+    case ast::ARR_ACC:
+      return access_array(root);
+    case ast::ARR_DYN:
+      return declare_empty_array(root);
+    case ast::STD_RETURN:
+      return std_return(root);
+    case ast::BINOP:
+      switch (tree[root].token) {
+        case tk::PLUS:
+          return binop<tk::PLUS>(root);
+        case tk::MINUS:
+          return binop<tk::MINUS>(root);
+        case tk::MULT:
+          return binop<tk::MULT>(root);
+        case tk::DIV_WOQ:
+          return binop<tk::DIV_WOQ>(root);
+        case tk::DIV_WQ:
+          return binop<tk::DIV_WQ>(root);
+        case tk::MOD:
+          return binop<tk::MOD>(root);
+      }
+      break;
+    case ast::INPUT:
+      return input(root);
+    case ast::METHOD_CALL:
+      return method_call(root);
+  }
+  return [this, line]() {
+    error("Unexpected behavior", line);
+    return val::Value();
+  };
+}
+
+ClosureEngine::expr ClosureEngine::negative(ast::node root) {
+  unsigned line = tree[root].line;
+  return with_operand(tree.child(root, 0), [&](auto operand) -> expr {
+    return [this, operand, line]() {
+      const val::Value &value = operand(this);
+      if (!value.is_number())
+        error_rt("Cannot make negative value from " + value.type_name(),
+                 line);
+      return val::negate(value);
+    };
+  });
+}
+
+// the shape is checked before any element is evaluated
+ClosureEngine::expr ClosureEngine::make_array(ast::node root) {
+  std::vector<unsigned> dims;
+  std::vector<ast::node> elements;
+  std::string message;
+  ast::node at = root;
+  for (ast::node n = root; tree[n].id == ast::ARR; n = tree.child(n, 0)) {
+    dims.push_back(tree.children(n).size());
+    if (tree.children(n).empty()) break;
+  }
+  if (!get_contents(root, dims, 0, elements, message, at)) {
+    unsigned line = tree[at].line;
+    return [this, message, line]() {
+      error(message, line);
+      return val::Value();
+    };
+  }
+  std::vector<expr> values;
+  for (auto a : elements) {
+    values.push_back(compute(a));
+  }
+  return [dims, values]() {
+    val::Array *arr = new val::Array;
+    val::Value out(val::ARR, arr);
+    arr->dims = dims;
+    for (auto &a : values) {
+      arr->push(a());
+    }
+    return out;
+  };
+}
+
+// false with the error and the node it is at when the array is not
+// rectangular
+bool ClosureEngine::get_contents(ast::node root, std::vector<unsigned> &dims,
+                                 unsigned nesting,
+                                 std::vector<ast::node> &elements,
+                                 std::string &message, ast::node &at) {
+  at = root;
+  if (tree.children(root).size() != dims[nesting]) {
+    message = "ragged array";
+    return false;
+  }
+  for (auto a : tree.children(root)) {
+    if (tree[a].id == ast::ARR && nesting + 1 < dims.size()) {
+      if (!get_contents(a, dims, nesting + 1, elements, message, at))
+        return false;
+    } else if (tree[a].id != ast::ARR && nesting == dims.size() - 1) {
+      elements.push_back(a);
+    } else {
+      at = root;
+      message = "inconsistent array nesting";
+      return false;
+    }
+  }
+  return true;
+}
+
+ClosureEngine::expr ClosureEngine::declare_empty_array(ast::node root) {
+  std::vector<expr> args;
+  for (auto a : tree.children(root)) {
+    args.push_back(compute(a));
+  }
+  unsigned line = tree[root].line;
+  return [this, args, line]() {
+    val::Array *arr = new val::Array;
+    val::Value out(val::ARR, arr);
+    std::size_t size = 1;
+    for (auto &a : args) {
+      val::Value arg = a();
+      if (!arg.is_number() || val::to_double(arg) < 0)
+        error("Only viable argument is a number", line);
+      arr->dims.push_back(val::to_int(arg));
+      size *= arr->dims.back();
+    }
+    arr->zeros(size);
+    return out;
+  };
+}
+
+// the indices are computed before the array is looked up
+ClosureEngine::expr ClosureEngine::access_array(ast::node root) {
+  unsigned slot = tree[root].slot;
+  unsigned line = tree[root].line;
+  std::string name = tree.str(root);
+  if (tree.children(root).size() == 1)
+    return with_operand(tree.child(root, 0), [&](auto key) -> expr {
+      return [this, slot, line, name, key]() {
+        const val::Value &k = key(this);
+        val::Array *arr = lookup_array(slot, line, name);
+        return arr->get(compute_key(arr, &k, 1, line));
+      };
+    });
+  std::vector<expr> keys;
+  for (auto a : tree.children(root)) {
+    keys.push_back(compute(a));
+  }
+  return [this, slot, line, name, keys]() {
+    std::vector<val::Value> k;
+    for (auto &a : keys) {
+      k.push_back(a());
+    }
+    val::Array *arr = lookup_array(slot, line, name);
+    return arr->get(compute_key(arr, k.data(), k.size(), line));
+  };
+}
+
+val::Array *ClosureEngine::lookup_array(unsigned slot, unsigned line,
+                                        const std::string &name) {
+  val::Value &arr = call_stack.peek(slot, line);
+  if (arr.kind != val::ARR) error(name + " is not an array", line);
+  return val::as_array(arr);
+}
+
+// row-major address of the element, every key is checked against its
+// dimension
+unsigned ClosureEngine::compute_key(const val::Array *arr,
+                                    const val::Value *keys, unsigned count,
+                                    unsigned line) {
+  unsigned addr = 0;
+  long long key;
+  if (count != arr->dims.size())
+    error("array has " + std::to_string(arr->dims.size()) + " dimensions, " +
+              std::to_string(count) + " indices given",
+          line);
+  for (unsigned i = 0; i < count; ++i) {
+    if (!keys[i].is_number()) error("Only viable argument is a number", line);
+    key = val::to_int(keys[i]);
+    if (key < 0 || key >= arr->dims[i])
+      error("index " + std::to_string(key) + " out of bounds", line);
+    addr = addr * arr->dims[i] + key;
+  }
+  return addr;
+}
+
+ClosureEngine::expr ClosureEngine::std_return(ast::node root) {
+  unsigned slot = tree[root].slot;
+  unsigned line = tree[root].line;
+  switch (tree[tree.children(root).back()].token) {
+    case tk::LENGTH:
+      return [this, slot, line]() {
+        return val::Value(val::length(call_stack.peek(slot, line)));
+      };
+    case tk::POP:
+      return [this, slot, line]() {
+        val::Value &stk = call_stack.peek(slot, line);
+        if (stk.kind != val::STACK)
+          error("'pop' can only be performed on stacks", line);
+        if (val::length(stk) == 0)
+          error("Cannot perform 'pop' on an empty stack", line);
+        stk.detach();
+        return val::as_stack(stk)->pop();
+      };
+    case tk::DEQUEUE:
+      return [this, slot, line]() {
+        val::Value &que = call_stack.peek(slot, line);
+        if (que.kind != val::QUEUE)
+          error("'dequeue' can only be performed on queues", line);
+        if (val::length(que) == 0)
+          error("Cannot perform 'pop' on an empty stack", line);
+        que.detach();
+        return val::as_queue(que)->dequeue();
+      };
+    case tk::GET_NEXT:
+      return [this, slot, line]() {
+        val::Value &ref = call_stack.peek(slot, line);
+        if (!ref.is_container() || val::length(ref) == 0)
+          error("cannot perform 'getNext()' on an empty container", line);
+        if (ref.kind == val::ARR)
+          error("'getNext()' can only be perfromed on a stack or a queue",
+                line);
+        if (ref.kind == val::STACK) return val::as_stack(ref)->next();
+        return val::as_queue(ref)->next();
+      };
+    case tk::HAS_NEXT:
+      return [this, slot, line]() {
+        val::Value &ref = call_stack.peek(slot, line);
+        return val::Value((std::int64_t)(
+            ref.is_container() && val::length(ref) > 0 ? 1 : 0));
+      };
+    case tk::IS_EMPTY:
+      return [this, slot, line]() {
+        val::Value &ref = call_stack.peek(slot, line);
+        return val::Value((std::int64_t)(
+            ref.is_container() && val::length(ref) > 0 ? 0 : 1));
+      };
+  }
+  return [this, line]() {
+    error("Unexpected behavior", line);
+    return val::Value();
+  };
+}
+
+// the prompt is looked up when it is printed, as the tree walker does
+ClosureEngine::expr ClosureEngine::input(ast::node root) {
+  ast::node prompt = tree.child(root, 0);
+  unsigned line = tree[root].line;
+  return [this, prompt, line]() {
+    std::cout << tree.str(prompt);
+    std::string buffer;
+    std::cin >> buffer;
+    // a failed read is reported as the unexpected character it leaves behind
+    if (buffer.empty()) buffer.push_back('\0');
+    std::cout << std::endl;
+    lxr::Lexer lex(buffer);
+    tk::Token token;
+    if (!lex.get_next_token(token)) {
+      error(lex.get_error().message, line);
+    }
+    if (token.id == tk::NUM) return val::number(token);
+    return val::Value(token.val_str, token.id);
+  };
+}
+
+// anything but a comparison or 'and' and 'or' of them is false
+ClosureEngine::cond ClosureEngine::condition(ast::node root) {
+  if (tree[root].id == ast::COND) {
+    if (tree[root].token == tk::AND || tree[root].token == tk::OR) {
+      cond l = condition(tree.child(root, 0));
+      cond r = condition(tree.child(root, 1));
+      if (tree[root].token == tk::AND) return [l, r]() { return l() && r(); };
+      return [l, r]() { return l() || r(); };
+    }
+  } else if (tree[root].id == ast::CMP) {
+    switch (tree[root].token) {
+      case tk::LT:
+        return comparison<tk::LT>(root);
+      case tk::GT:
+        return comparison<tk::GT>(root);
+      case tk::LEQ:
+        return comparison<tk::LEQ>(root);
+      case tk::GEQ:
+        return comparison<tk::GEQ>(root);
+      case tk::DNEQ:
+        return comparison<tk::DNEQ>(root);
+      case tk::IS:
+        return comparison<tk::IS>(root);
+    }
+  }
+  return []() { return false; };
+}
+
+}  // namespace IBPCI
@@ -0,0 +1,506 @@
+#include "../include/compiler.hpp"
+
+namespace bc {
+
+Compiler::Compiler(ast::Tree &tree, rsv::scopes &scopes)
+    : tree(tree), scopes(scopes) {}
+
+Program Compiler::compile() {
+  chunk = &program.main;
+  chunk->name = "main";
+  chunk->locals = scopes[tree[tree.root].slot].locals;
+  depth = 0;
+  for (auto a : tree.children(tree.root)) {
+    stmt(a, true);
+  }
+  emit(HALT, 0, 0, tree.root);
+  return std::move(program);
+}
+
+int stack_effect(opcode op, int a, int b) {
+  switch (op) {
+    case CONST:
+    case LOAD:
+    case NEW_STACK:
+    case NEW_QUEUE:
+    case LENGTH:
+    case POP:
+    case DEQUEUE:
+    case GET_NEXT:
+    case HAS_NEXT:
+    case IS_EMPTY:
+    case INPUT:
+      return 1;
+    case LOAD_ELEM:
+    case CALL:
+    case MAKE_ARR:
+      return 1 - b;
+    case NEW_ARR:
+      return 1 - a;
+    case STORE_ELEM:
+      return -b - 1;
+    case FOR_INIT:
+      return -2;
+    case STORE:
+    case DISCARD:
+    case ADD:
+    case SUB:
+    case MUL:
+    case DIV:
+    case DIV_INT:
+    case MOD:
+    case LT:
+    case GT:
+    case LEQ:
+    case GEQ:
+    case DNEQ:
+    case IS:
+    case JUMP_IF_FALSE:
+    case JUMP_IF_TRUE:
+    case RETURN:
+    case PUSH:
+    case ENQUEUE:
+    case PRINT:
+      return -1;
+    default:
+      return 0;
+  }
+}
+
+unsigned Compiler::emit(opcode op, int a, int b, ast::node node) {
+  chunk->code.push_back({op, a, b});
+  chunk->lines.push_back(tree[node].line);
+  depth += stack_effect(op, a, b);
+  if (depth > chunk->max_stack) chunk->max_stack = depth;
+  return chunk->code.size() - 1;
+}
+
+unsigned Compiler::here() { return chunk->code.size(); }
+
+void Compiler::patch(unsigned jump) { chunk->code[jump].a = here(); }
+
+void Compiler::patch(std::vector<unsigned> &jumps) {
+  for (auto a : jumps) {
+    patch(a);
+  }
+  jumps.clear();
+}
+
+unsigned Compiler::slot(ast::node leaf) { return tree[leaf].slot; }
+
+unsigned Compiler::hidden_slots(unsigned count) {
+  for (unsigned i = 0; i < count; ++i) {
+    chunk->locals.push_back("");
+  }
+  return chunk->locals.size() - count;
+}
+
+unsigned Compiler::constant(std::int64_t value) {
+  auto it = int_constants.find(value);
+  if (it != int_constants.end()) return it->second;
+  program.constants.push_back(val::Value(value));
+  int_constants[value] = program.constants.size() - 1;
+  return program.constants.size() - 1;
+}
+
+unsigned Compiler::constant(double value) {
+  auto it = num_constants.find(value);
+  if (it != num_constants.end()) return it->second;
+  program.constants.push_back(val::Value(value));
+  num_constants[value] = program.constants.size() - 1;
+  return program.constants.size() - 1;
+}
+
+unsigned Compiler::constant(std::string value) {
+  auto it = str_constants.find(value);
+  if (it != str_constants.end()) return it->second;
+  program.constants.push_back(val::Value(value));
+  str_constants[value] = program.constants.size() - 1;
+  return program.constants.size() - 1;
+}
+
+unsigned Compiler::string(std::string value) {
+  program.strings.push_back(value);
+  return program.strings.size() - 1;
+}
+
+unsigned Compiler::method_name(std::string name) {
+  auto it = method_ids.find(name);
+  if (it != method_ids.end()) return it->second;
+  program.method_names.push_back(name);
+  method_ids[name] = program.method_names.size() - 1;
+  return program.method_names.size() - 1;
+}
+
+void Compiler::error(std::string message, error_kind kind, ast::node node) {
+  emit(ERROR, string(message), kind, node);
+}
+
+void Compiler::method(ast::node root) {
+  Chunk *caller = chunk;
+  unsigned caller_depth = depth;
+  unsigned index = program.methods.size();
+
+  program.methods.emplace_back();
+  chunk = &program.methods.back();
+  chunk->name = tree.str(root);
+  chunk->name_id = method_name(tree.str(root));
+  chunk->locals = scopes[tree[root].slot].locals;
+  chunk->params = scopes[tree[root].slot].params;
+  depth = 0;
+
+  block(tree.children(root).back(), true);
+  emit(RETURN_VOID, 0, 0, root);
+
+  depth = caller_depth;
+  chunk = caller;
+  emit(DECLARE, index, 0, root);
+}
+
+// top level statements follow Interpreter::interpret, which silently skips
+// the statements it does not handle, exec_block reports them instead
+void Compiler::stmt(ast::node root, bool top_level) {
+  switch (tree[root].id) {
+    case ast::ASSIGN:
+      assign(root);
+      break;
+    case ast::STD_VOID:
+      std_void(root);
+      break;
+    case ast::IF:
+      if_stmt(root);
+      break;
+    case ast::WHILE:
+      loop_whl(root);
+      break;
+    case ast::FOR:
+      loop_for(root);
+      break;
+    case ast::METHOD_CALL:
+      method_call(root);
+      emit(DISCARD, 0, 0, root);
+      break;
+    case ast::OUTPUT:
+      output(root);
+      break;
+    case ast::METHOD:
+      if (top_level) {
+        method(root);
+        break;
+      }
+      [[fallthrough]];
+    default:
+      if (!top_level) error("Unexpected behavior", SEMANTIC_ERROR, root);
+  }
+}
+
+// a return in a nested block only leaves that block, as in exec_block
+void Compiler::block(ast::node root, bool method_body) {
+  if (!method_body) block_exits.emplace_back();
+  for (auto a : tree.children(root)) {
+    if (tree[a].id == ast::RETURN) {
+      expr(tree.child(a, 0));
+      if (method_body) {
+        emit(RETURN, 0, 0, a);
+      } else {
+        emit(DISCARD, 0, 0, a);
+        block_exits.back().push_back(emit(JUMP, 0, 0, a));
+      }
+      break;
+    }
+    stmt(a, false);
+  }
+  if (!method_body) {
+    patch(block_exits.back());
+    block_exits.pop_back();
+  }
+}
+
+void Compiler::if_stmt(ast::node root) {
+  std::vector<unsigned> next, end;
+  ast::node n;
+  branch(tree.child(root, 0), false, next);
+  block(tree.child(root, 1), false);
+  for (unsigned i = 2; i < tree.children(root).size(); ++i) {
+    n = tree.child(root, i);
+    end.push_back(emit(JUMP, 0, 0, n));
+    patch(next);
+    if (tree[n].id == ast::ELIF) {
+      branch(tree.child(n, 0), false, next);
+      block(tree.child(n, 1), false);
+    } else if (tree[n].id == ast::ELSE) {
+      block(tree.child(n, 0), false);
+      break;
+    }
+  }
+  patch(next);
+  patch(end);
+}
+
+void Compiler::loop_whl(ast::node root) {
+  std::vector<unsigned> exit;
+  unsigned top = here();
+  branch(tree.child(root, 0), false, exit);
+  block(tree.child(root, 1), false);
+  emit(JUMP, top, 0, root);
+  patch(exit);
+}
+
+// from and to are truncated once, the body always runs at least once and
+// assignments to the iterator do not affect the iteration, as in exec_for
+void Compiler::loop_for(ast::node root) {
+  ast::node rng = tree.child(root, 0);
+  unsigned iter = slot(tree.child(rng, 0));
+  unsigned counter = hidden_slots(3);
+  expr(tree.child(rng, 1));
+  expr(tree.child(rng, 2));
+  emit(FOR_INIT, counter, iter, rng);
+  unsigned top = here();
+  emit(FOR_ITER, counter, iter, rng);
+  block(tree.child(root, 1), false);
+  emit(FOR_NEXT, counter, top, root);
+}
+
+void Compiler::assign(ast::node root) {
+  ast::node target = tree.child(root, 0);
+  expr(tree.child(root, 1));
+  if (tree[target].id == ast::ARR_ACC) {
+    for (auto a : tree.children(target)) {
+      expr(a);
+    }
+    emit(STORE_ELEM, slot(target), tree.children(target).size(), target);
+  } else {
+    emit(STORE, slot(target), 0, target);
+  }
+}
+
+void Compiler::std_void(ast::node root) {
+  ast::node var = tree.child(root, 0);
+  ast::node std_method = tree.children(var).back();
+  if (tree.children(std_method).empty()) {
+    error("Unexpected behavior", SEMANTIC_ERROR, std_method);
+    return;
+  }
+  switch (tree[std_method].token) {
+    case tk::PUSH:
+      expr(tree.child(std_method, 0));
+      emit(PUSH, slot(var), 0, var);
+      break;
+    case tk::ENQUEUE:
+      expr(tree.child(std_method, 0));
+      emit(ENQUEUE, slot(var), 0, var);
+      break;
+  }
+}
+
+void Compiler::method_call(ast::node root) {
+  unsigned argc = 0;
+  if (!tree.children(root).empty()) {
+    for (auto a : tree.children(tree.child(root, 0))) {
+      expr(a);
+      ++argc;
+    }
+  }
+  emit(CALL, method_name(tree.str(root)), argc, root);
+}
+
+void Compiler::output(ast::node root) {
+  for (auto a : tree.children(root)) {
+    expr(a);
+    emit(PRINT, 0, 0, a);
+  }
+  emit(PRINT_NL, 0, 0, root);
+}
+
+void Compiler::expr(ast::node root) {
+  switch (tree[root].id) {
+    case ast::NUM:
+      if (tree[root].num_type == tk::INT)
+        emit(CONST, constant((std::int64_t)tree.num(root)), 0, root);
+      else
+        emit(CONST, constant(tree.num(root)), 0, root);
+      break;
+    case ast::STRING:
+      emit(CONST, constant(tree.str(root)), 0, root);
+      break;
+    case ast::ID:
+      emit(LOAD, slot(root), 0, root);
+      break;
+    case ast::UN_MIN:
+      expr(tree.child(root, 0));
+      emit(NEG, 0, 0, root);
+      break;
+    case ast::STACK:
+      emit(NEW_STACK, 0, 0, root);
+      break;
+    case ast::QUEUE:
+      emit(NEW_QUEUE, 0, 0, root);
+      break;
+    case ast::ARR:
+      make_array(root);
+      break;
+    case ast::ARR_ACC:
+      for (auto a : tree.children(root)) {
+        expr(a);
+      }
+      emit(LOAD_ELEM, slot(root), tree.children(root).size(), root);
+      break;
+    case ast::ARR_DYN:
+      for (auto a : tree.children(root)) {
+        expr(a);
+      }
+      emit(NEW_ARR, tree.children(root).size(), 0, root);
+      break;
+    case ast::STD_RETURN:
+      std_return(root);
+      break;
+    case ast::BINOP:
+      expr(tree.child(root, 0));
+      expr(tree.child(root, 1));
+      switch (tree[root].token) {
+        case tk::PLUS:
+          emit(ADD, 0, 0, root);
+          break;
+        case tk::MINUS:
+          emit(SUB, 0, 0, root);
+          break;
+        case tk::MULT:
+          emit(MUL, 0, 0, root);
+          break;
+        case tk::DIV_WOQ:
+          emit(DIV, 0, 0, root);
+          break;
+        case tk::DIV_WQ:
+          emit(DIV_INT, 0, 0, root);
+          break;
+        case tk::MOD:
+          emit(MOD, 0, 0, root);
+          break;
+      }
+      break;
+    case ast::INPUT:
+      emit(INPUT, string(tree.str(tree.child(root, 0))), 0, root);
+      break;
+    case ast::METHOD_CALL:
+      method_call(root);
+      break;
+    default:
+      error("Unexpected behavior", SEMANTIC_ERROR, root);
+      ++depth;
+  }
+}
+
+// emits a jump taken when the condition evaluates to jump_if, anything that
+// is not a comparison is false without being evaluated, as in condition()
+void Compiler::branch(ast::node root, bool jump_if,
+                      std::vector<unsigned> &jumps) {
+  std::vector<unsigned> skip;
+  if (tree[root].id == ast::COND &&
+      (tree[root].token == tk::AND || tree[root].token == tk::OR)) {
+    bool is_and = tree[root].token == tk::AND;
+    if (jump_if != is_and) {
+      branch(tree.child(root, 0), jump_if, jumps);
+      branch(tree.child(root, 1), jump_if, jumps);
+    } else {
+      branch(tree.child(root, 0), !jump_if, skip);
+      branch(tree.child(root, 1), jump_if, jumps);
+      patch(skip);
+    }
+  } else if (tree[root].id == ast::CMP) {
+    expr(tree.child(root, 0));
+    expr(tree.child(root, 1));
+    switch (tree[root].token) {
+      case tk::LT:
+        emit(LT, 0, 0, root);
+        break;
+      case tk::GT:
+        emit(GT, 0, 0, root);
+        break;
+      case tk::LEQ:
+        emit(LEQ, 0, 0, root);
+        break;
+      case tk::GEQ:
+        emit(GEQ, 0, 0, root);
+        break;
+      case tk::DNEQ:
+        emit(DNEQ, 0, 0, root);
+        break;
+      default:
+        emit(IS, 0, 0, root);
+    }
+    jumps.push_back(emit(jump_if ? JUMP_IF_TRUE : JUMP_IF_FALSE, 0, 0, root));
+  } else if (!jump_if) {
+    jumps.push_back(emit(JUMP, 0, 0, root));
+  }
+}
+
+// the shape of a literal is known statically, a malformed literal compiles to
+// the error Interpreter::get_contents would raise
+void Compiler::make_array(ast::node root) {
+  std::vector<unsigned> dims;
+  std::vector<ast::node> elements;
+  ast::node n = root;
+  while (tree[n].id == ast::ARR) {
+    dims.push_back(tree.children(n).size());
+    if (tree.children(n).empty()) break;
+    n = tree.child(n, 0);
+  }
+  if (!get_contents(root, dims, 0, elements)) {
+    ++depth;
+    return;
+  }
+  for (auto a : elements) {
+    expr(a);
+  }
+  program.shapes.push_back(dims);
+  emit(MAKE_ARR, program.shapes.size() - 1, elements.size(), root);
+}
+
+bool Compiler::get_contents(ast::node root, std::vector<unsigned> &dims,
+                            unsigned nesting,
+                            std::vector<ast::node> &elements) {
+  if (tree.children(root).size() != dims[nesting]) {
+    error("ragged array", SEMANTIC_ERROR, root);
+    return false;
+  }
+  for (auto a : tree.children(root)) {
+    if (tree[a].id == ast::ARR && nesting + 1 < dims.size()) {
+      if (!get_contents(a, dims, nesting + 1, elements)) return false;
+    } else if (tree[a].id != ast::ARR && nesting == dims.size() - 1) {
+      elements.push_back(a);
+    } else {
+      error("inconsistent array nesting", SEMANTIC_ERROR, root);
+      return false;
+    }
+  }
+  return true;
+}
+
+void Compiler::std_return(ast::node root) {
+  unsigned var = slot(root);
+  switch (tree[tree.children(root).back()].token) {
+    case tk::LENGTH:
+      emit(LENGTH, var, 0, root);
+      break;
+    case tk::POP:
+      emit(POP, var, 0, root);
+      break;
+    case tk::DEQUEUE:
+      emit(DEQUEUE, var, 0, root);
+      break;
+    case tk::GET_NEXT:
+      emit(GET_NEXT, var, 0, root);
+      break;
+    case tk::HAS_NEXT:
+      emit(HAS_NEXT, var, 0, root);
+      break;
+    case tk::IS_EMPTY:
+      emit(IS_EMPTY, var, 0, root);
+      break;
+    default:
+      error("Unexpected behavior", SEMANTIC_ERROR, root);
+      ++depth;
+  }
+}
+
+}  // namespace bc
@@ -0,0 +1,73 @@
+#include "../include/diagnostics.hpp"
+
+namespace dg {
+
+Settings settings;
+
+namespace {
+
+const char *level_name(level at) {
+  switch (at) {
+    case TRACE:
+      return "trace";
+    case DEBUG:
+      return "debug";
+    default:
+      return "info";
+  }
+}
+
+const char *category_name(category in) {
+  switch (in) {
+    case LEXER:
+      return "lexer";
+    case PARSER:
+      return "parser";
+    default:
+      return "runtime";
+  }
+}
+
+}  // namespace
+
+bool configure(std::string_view spec) {
+  level threshold = DEBUG;
+  std::size_t colon = spec.find(':');
+  if (colon != std::string_view::npos) {
+    std::string_view name = spec.substr(colon + 1);
+    if (name == "trace")
+      threshold = TRACE;
+    else if (name == "info")
+      threshold = INFO;
+    else if (name != "debug")
+      return false;
+    spec = spec.substr(0, colon);
+  }
+  unsigned categories = 0;
+  while (!spec.empty()) {
+    std::size_t comma = spec.find(',');
+    std::string_view name = spec.substr(0, comma);
+    if (name == "lexer")
+      categories |= LEXER;
+    else if (name == "parser")
+      categories |= PARSER;
+    else if (name == "runtime")
+      categories |= RUNTIME;
+    else if (name == "all")
+      categories |= ALL;
+    else
+      return false;
+    spec = comma == std::string_view::npos ? "" : spec.substr(comma + 1);
+  }
+  if (categories == 0) return false;
+  settings.threshold = threshold;
+  settings.categories = categories;
+  return true;
+}
+
+std::ostream &log(level at, category in) {
+  return std::cerr << "[" << category_name(in) << " " << level_name(at)
+                   << "] ";
+}
+
+}  // namespace dg
@@ -0,0 +1,662 @@
+#include "../include/emitter.hpp"
+
+namespace IBPCI {
+
+namespace {
+
+// the name the runtime templates take the operator of a node by
+std::string op_name(int token) {
+  switch (token) {
+    case tk::PLUS:
+      return "tk::PLUS";
+    case tk::MINUS:
+      return "tk::MINUS";
+    case tk::MULT:
+      return "tk::MULT";
+    case tk::DIV_WOQ:
+      return "tk::DIV_WOQ";
+    case tk::DIV_WQ:
+      return "tk::DIV_WQ";
+    case tk::MOD:
+      return "tk::MOD";
+    case tk::LT:
+      return "tk::LT";
+    case tk::GT:
+      return "tk::GT";
+    case tk::LEQ:
+      return "tk::LEQ";
+    case tk::GEQ:
+      return "tk::GEQ";
+    case tk::DNEQ:
+      return "tk::DNEQ";
+    default:
+      return "tk::IS";
+  }
+}
+
+// a double literal that reads back as the same double
+std::string float_literal(double num) {
+  std::ostringstream out;
+  out << std::setprecision(17) << num;
+  std::string text = out.str();
+  if (text.find_first_of(".e") == std::string::npos) text += ".0";
+  return text;
+}
+
+std::string join(const std::vector<std::string> &items) {
+  std::string out;
+  for (auto &a : items) {
+    if (!out.empty()) out += ", ";
+    out += a;
+  }
+  return out;
+}
+
+}  // namespace
+
+std::string quote(const std::string &text) {
+  std::string out = "\"";
+  for (char c : text) {
+    unsigned char u = c;
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        // three octal digits never run into the character after them
+        if (u < 0x20 || u >= 0x7f) {
+          out += '\\';
+          out += (char)('0' + (u >> 6));
+          out += (char)('0' + ((u >> 3) & 7));
+          out += (char)('0' + (u & 7));
+        } else {
+          out += c;
+        }
+    }
+  }
+  return out + "\"";
+}
+
+CppEmitter::CppEmitter(ast::Tree &tree, rsv::scopes &scopes)
+    : tree(tree), scopes(scopes) {
+  for (auto a : tree.children(tree.root)) {
+    if (tree[a].id != ast::METHOD || method_ids.count(tree.str(a)) != 0)
+      continue;
+    method_ids.emplace(tree.str(a), methods.size());
+    methods.push_back(a);
+  }
+}
+
+std::string CppEmitter::emit() {
+  std::string definitions, prototypes;
+  for (unsigned i = 0; i < methods.size(); ++i) {
+    method(i);
+    std::string signature = "rt::Value " + function(i) +
+                            "(unsigned line, rt::Value *args, unsigned count)";
+    prototypes += signature + ";\n";
+    definitions += "\n" + signature + " {\n" + body() + "}\n";
+  }
+
+  scope = &scopes[tree[tree.root].slot];
+  lines.clear();
+  temps = 0;
+  depth = 1;
+  line(frame());
+  for (auto a : tree.children(tree.root)) {
+    switch (tree[a].id) {
+      case ast::ASSIGN:
+      case ast::STD_VOID:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::FOR:
+      case ast::METHOD:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        statement(a);
+        break;
+    }
+  }
+  // the frame is left to the OS, as the interpreter leaves its values; taking
+  // apart a large array costs a pass over all of its pages
+  line("std::exit(0);");
+
+  std::string out =
+      "// translated from IB pseudocode by ibpci --emit-cpp, build with\n"
+      "//   c++ -std=c++17 -O2 -I<ibpci/include> <this file>\n"
+      "#include \"cpp_runtime.hpp\"\n\nnamespace {\n\n";
+  if (!methods.empty())
+    out += "bool declared[" + std::to_string(methods.size()) + "];\n\n";
+  if (!constants.empty()) out += constants + "\n";
+  out += prototypes + definitions;
+  out += "\n}  // namespace\n\nint main() {\n" + body() + "}\n";
+  return out;
+}
+
+void CppEmitter::line(const std::string &code) {
+  lines.push_back(std::string(2 * depth, ' ') + code);
+}
+
+std::string CppEmitter::temp(const std::string &prefix) {
+  return prefix + std::to_string(temps++);
+}
+
+std::string CppEmitter::function(unsigned id) {
+  return "m" + std::to_string(id) + "_" + tree.str(methods[id]);
+}
+
+// the operand as a value to be stored, temporaries are moved
+std::string CppEmitter::take(const Operand &value) {
+  if (value.kind == TEMPORARY) return "std::move(" + value.code + ")";
+  return value.code;
+}
+
+// the value of the variable as it is now, for when more is computed before
+// it is used
+CppEmitter::Operand CppEmitter::snapshot(const Operand &value) {
+  if (value.kind != REFERENCE) return value;
+  Operand out{temp("t"), TEMPORARY};
+  line("rt::Value " + out.code + " = " + value.code + ";");
+  return out;
+}
+
+std::string CppEmitter::variable(ast::node leaf) {
+  return "v[" + std::to_string(tree[leaf].slot) + "]";
+}
+
+std::string CppEmitter::name(ast::node leaf) {
+  return quote(scope->locals[tree[leaf].slot]);
+}
+
+std::string CppEmitter::frame() {
+  std::size_t size = scope->locals.empty() ? 1 : scope->locals.size();
+  return "rt::Value v[" + std::to_string(size) + "];";
+}
+
+std::string CppEmitter::body() {
+  std::string out;
+  for (auto &a : lines) {
+    out += a + "\n";
+  }
+  return out;
+}
+
+// the binding to its name is checked on every call, a method can be called
+// before its declaration has run
+void CppEmitter::method(unsigned id) {
+  ast::node root = methods[id];
+  ast::node first = tree.child(root, 0);
+  std::string message = quote("Undefined reference to method " +
+                              tree.str(root));
+  scope = &scopes[tree[root].slot];
+  lines.clear();
+  temps = 0;
+  depth = 1;
+  line("if (!declared[" + std::to_string(id) + "]) rt::error(" + message +
+       ", line);");
+  if (tree[first].id != ast::BLOCK) {
+    unsigned count = tree.children(first).size();
+    line("if (count != " + std::to_string(count) + ")");
+    line("  rt::error(" +
+         quote("Incorrect number of arguments in the call of function " +
+               scope->name) +
+         ", line);");
+    line(frame());
+    for (unsigned i = 0; i < count; ++i) {
+      line(variable(tree.child(first, i)) + " = std::move(args[" +
+           std::to_string(i) + "]);");
+    }
+  } else {
+    // without a parameter list the arguments are computed and dropped
+    line("(void)args, (void)count;");
+    line(frame());
+  }
+  if (!block(tree.children(root).back(), true))
+    line("return rt::Value(rt::VOID);");
+}
+
+// a statement in main or in a block, in a scope of its own when it takes
+// more than one line, so that its temporaries go away with it
+void CppEmitter::statement(ast::node root) {
+  if (tree[root].id == ast::WHILE) {
+    exec_whl(root);
+    return;
+  }
+  std::size_t mark = lines.size();
+  ++depth;
+  switch (tree[root].id) {
+    case ast::ASSIGN:
+      assign(root);
+      break;
+    case ast::STD_VOID:
+      std_void(root);
+      break;
+    case ast::IF:
+      exec_if(root);
+      break;
+    case ast::FOR:
+      exec_for(root);
+      break;
+    case ast::METHOD:
+      method_decl(root);
+      break;
+    case ast::METHOD_CALL:
+      line(method_call(root) + ";");
+      break;
+    case ast::OUTPUT:
+      output(root);
+      break;
+  }
+  --depth;
+  if (lines.size() == mark + 1) {
+    lines[mark].erase(0, 2);
+  } else if (lines.size() > mark) {
+    lines.insert(lines.begin() + mark, std::string(2 * depth, ' ') + "{");
+    line("}");
+  }
+}
+
+// What follows a return is never run and not emitted. A return only ends
+// its block, only the one ending the body of a method returns from it.
+// Returns whether the block ends before its last statement does.
+bool CppEmitter::block(ast::node root, bool returns) {
+  for (auto a : tree.children(root)) {
+    switch (tree[a].id) {
+      case ast::ASSIGN:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::STD_VOID:
+      case ast::FOR:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        statement(a);
+        break;
+      case ast::RETURN: {
+        Operand value = compute(tree.child(a, 0));
+        // a returned temporary is moved out without std::move
+        if (returns)
+          line("return " +
+               (value.kind == TEMPORARY ? value.code : take(value)) + ";");
+        else if (value.kind == REFERENCE)
+          line("(void)" + value.code + ";");
+        return true;
+      }
+      default:
+        unexpected(a);
+        return true;
+    }
+  }
+  return false;
+}
+
+void CppEmitter::method_decl(ast::node root) {
+  unsigned id = method_ids[tree.str(root)];
+  line("rt::declare(declared[" + std::to_string(id) + "], " +
+       std::to_string(tree[root].line) + ");");
+}
+
+// every 'else if' nests in the else of the branch before it, its condition
+// is only computed when none of those was taken
+void CppEmitter::exec_if(ast::node root) {
+  unsigned opened = 0;
+  line("if (" + condition(tree.child(root, 0)) + ") {");
+  ++depth;
+  block(tree.child(root, 1), false);
+  --depth;
+  for (unsigned i = 2; i < tree.children(root).size(); ++i) {
+    ast::node n = tree.child(root, i);
+    line("} else {");
+    ++depth;
+    if (tree[n].id == ast::ELSE) {
+      block(tree.child(n, 0), false);
+      --depth;
+      break;
+    }
+    ++opened;
+    line("if (" + condition(tree.child(n, 0)) + ") {");
+    ++depth;
+    block(tree.child(n, 1), false);
+    --depth;
+  }
+  line("}");
+  while (opened-- > 0) {
+    --depth;
+    line("}");
+  }
+}
+
+void CppEmitter::exec_whl(ast::node root) {
+  line("for (;;) {");
+  ++depth;
+  line("if (!" + condition(tree.child(root, 0)) + ") break;");
+  block(tree.child(root, 1), false);
+  --depth;
+  line("}");
+}
+
+// counts from one bound to the other, both included, down when the first is
+// larger
+void CppEmitter::exec_for(ast::node root) {
+  ast::node rng = tree.child(root, 0);
+  Operand from = compute(tree.child(rng, 1));
+  Operand to = compute(tree.child(rng, 2));
+  std::string range = temp("n"), i = temp("i");
+  line("rt::Range " + range + " = rt::range(" + from.code + ", " + to.code +
+       ", " + std::to_string(tree[rng].line) + ");");
+  line("for (std::int64_t " + i + " = " + range + ".from;; " + i +
+       " += " + range + ".step) {");
+  ++depth;
+  line(variable(tree.child(rng, 0)) + " = rt::Value(" + i + ");");
+  block(tree.child(root, 1), false);
+  line("if (" + i + " == " + range + ".to) break;");
+  --depth;
+  line("}");
+}
+
+// the value is computed before the indices
+void CppEmitter::assign(ast::node root) {
+  ast::node target = tree.child(root, 0);
+  Operand value = compute(tree.child(root, 1));
+  if (tree[target].id != ast::ARR_ACC) {
+    line(variable(target) + " = " + take(value) + ";");
+    return;
+  }
+  value = snapshot(value);
+  std::string indices = keys(target);
+  line("rt::store(" + variable(target) + ", " +
+       std::to_string(tree[target].line) + ", " + name(target) +
+       ", " + indices + ", " + take(value) + ");");
+}
+
+void CppEmitter::std_void(ast::node root) {
+  ast::node target = tree.child(root, 0);
+  ast::node std_method = tree.children(target).back();
+  if (tree.children(std_method).empty()) {
+    unexpected(std_method);
+    return;
+  }
+  std::string call;
+  switch (tree[std_method].token) {
+    case tk::PUSH:
+      call = "rt::push(";
+      break;
+    case tk::ENQUEUE:
+      call = "rt::enqueue(";
+      break;
+    default:
+      return;
+  }
+  Operand value = compute(tree.child(std_method, 0));
+  line(call + variable(target) + ", " + std::to_string(tree[target].line) +
+       ", " + name(target) + ", " + take(value) + ");");
+}
+
+// every value is printed as soon as it is computed
+void CppEmitter::output(ast::node root) {
+  for (auto a : tree.children(root)) {
+    line("rt::print(" + compute(a).code + ");");
+  }
+  line("rt::newline();");
+}
+
+void CppEmitter::unexpected(ast::node root) {
+  line("rt::error(\"Unexpected behavior\", " +
+       std::to_string(tree[root].line) + ");");
+}
+
+CppEmitter::Operand CppEmitter::compute(ast::node root) {
+  std::string line_number = std::to_string(tree[root].line);
+  Operand out{temp("t"), TEMPORARY};
+  switch (tree[root].id) {
+    case ast::NUM:
+      if (tree[root].num_type == tk::INT)
+        return {"rt::Value((std::int64_t)" +
+                    std::to_string((std::int64_t)tree.num(root)) + ")",
+                CONSTANT};
+      return {"rt::Value(" + float_literal(tree.num(root)) + ")", CONSTANT};
+    case ast::STRING:
+      return string_constant(tree.str(root));
+    case ast::ID:
+      out = {"r" + out.code.substr(1), REFERENCE};
+      line("const rt::Value &" + out.code + " = rt::read(" + variable(root) +
+           ", " + line_number + ", " + name(root) + ");");
+      return out;
+    case ast::UN_MIN: {
+      Operand value = compute(tree.child(root, 0));
+      line("rt::Value " + out.code + " = rt::negative(" + value.code + ", " +
+           line_number + ");");
+      return out;
+    }
+    case ast::STACK:
+      return {"rt::stack()", CONSTANT};
+    case ast::QUEUE:
+      return {"rt::queue()", CONSTANT};
+    case ast::ARR:
+      return make_array(root);
+    case ast::ARR_ACC: {
+      std::string indices = keys(root);
+      line("rt::Value " + out.code + " = rt::at(" + variable(root) + ", " +
+           line_number + ", " + name(root) + ", " + indices +
+           ");");
+      return out;
+    }
+    case ast::ARR_DYN:
+      return declare_empty_array(root);
+    case ast::STD_RETURN:
+      return std_return(root);
+    case ast::BINOP: {
+      Operand l = compute(tree.child(root, 0));
+      Operand r = compute(tree.child(root, 1));
+      line("rt::Value " + out.code + " = rt::arith<" +
+           op_name(tree[root].token) + ">(" + l.code + ", " + r.code + ", " +
+           line_number + ");");
+      return out;
+    }
+    case ast::INPUT: {
+      const std::string &prompt = tree.str(tree.child(root, 0));
+      line("rt::Value " + out.code + " = rt::input(std::string_view(" +
+           quote(prompt) + ", " + std::to_string(prompt.size()) + "), " +
+           line_number + ");");
+      return out;
+    }
+    case ast::METHOD_CALL: {
+      std::string call = method_call(root);
+      line("rt::Value " + out.code + " = " + call + ";");
+      return out;
+    }
+  }
+  unexpected(root);
+  return {"rt::Value()", CONSTANT};
+}
+
+CppEmitter::Operand CppEmitter::string_constant(const std::string &text) {
+  auto it = strings.find(text);
+  if (it == strings.end()) {
+    it = strings.emplace(text, strings.size()).first;
+    constants += "const rt::Value s" + std::to_string(it->second) +
+                 "(std::string(" + quote(text) + ", " +
+                 std::to_string(text.size()) + "), tk::STRING);\n";
+  }
+  return {"s" + std::to_string(it->second), CONSTANT};
+}
+
+// the arguments are computed before the method is looked up
+std::string CppEmitter::method_call(ast::node root) {
+  std::vector<std::string> args;
+  std::string line_number = std::to_string(tree[root].line);
+  Operand last{"", CONSTANT};
+  if (!tree.children(root).empty() &&
+      tree[tree.child(root, 0)].id == ast::PARAM) {
+    ast::Children params = tree.children(tree.child(root, 0));
+    for (unsigned i = 0; i < params.size(); ++i) {
+      Operand value = compute(params[i]);
+      if (i + 1 < params.size()) value = snapshot(value);
+      last = value;
+      args.push_back(take(value));
+    }
+  }
+  auto it = method_ids.find(tree.str(root));
+  if (it == method_ids.end()) {
+    if (last.kind == REFERENCE) line("(void)" + last.code + ";");
+    line("rt::error(" +
+         quote("Undefined reference to method " + tree.str(root)) + ", " +
+         line_number + ");");
+    return "rt::Value()";
+  }
+  std::string array = "nullptr";
+  if (!args.empty()) {
+    array = temp("a");
+    line("rt::Value " + array + "[] = {" + join(args) + "};");
+  }
+  return function(it->second) + "(" + line_number + ", " + array + ", " +
+         std::to_string(args.size()) + ")";
+}
+
+// the shape is checked when the program is emitted, any error in it is
+// raised before any element is computed
+CppEmitter::Operand CppEmitter::make_array(ast::node root) {
+  std::vector<unsigned> dims;
+  std::vector<ast::node> elements;
+  std::string message;
+  ast::node at = root;
+  for (ast::node n = root; tree[n].id == ast::ARR; n = tree.child(n, 0)) {
+    dims.push_back(tree.children(n).size());
+    if (tree.children(n).empty()) break;
+  }
+  if (!get_contents(root, dims, 0, elements, message, at)) {
+    line("rt::error(" + quote(message) + ", " +
+         std::to_string(tree[at].line) + ");");
+    return {"rt::Value()", CONSTANT};
+  }
+  std::vector<std::string> sizes, items;
+  for (auto a : dims) {
+    sizes.push_back(std::to_string(a));
+  }
+  for (unsigned i = 0; i < elements.size(); ++i) {
+    Operand value = compute(elements[i]);
+    if (i + 1 < elements.size()) value = snapshot(value);
+    items.push_back(take(value));
+  }
+  Operand out{temp("t"), TEMPORARY};
+  line("rt::Value " + out.code + " = rt::array({" + join(sizes) + "}, {" +
+       join(items) + "});");
+  return out;
+}
+
+// false with the error and the node it is at when the array is not
+// rectangular
+bool CppEmitter::get_contents(ast::node root, std::vector<unsigned> &dims,
+                              unsigned nesting,
+                              std::vector<ast::node> &elements,
+                              std::string &message, ast::node &at) {
+  at = root;
+  if (tree.children(root).size() != dims[nesting]) {
+    message = "ragged array";
+    return false;
+  }
+  for (auto a : tree.children(root)) {
+    if (tree[a].id == ast::ARR && nesting + 1 < dims.size()) {
+      if (!get_contents(a, dims, nesting + 1, elements, message, at))
+        return false;
+    } else if (tree[a].id != ast::ARR && nesting == dims.size() - 1) {
+      elements.push_back(a);
+    } else {
+      at = root;
+      message = "inconsistent array nesting";
+      return false;
+    }
+  }
+  return true;
+}
+
+CppEmitter::Operand CppEmitter::declare_empty_array(ast::node root) {
+  std::string line_number = std::to_string(tree[root].line);
+  Operand out{temp("t"), TEMPORARY};
+  line("rt::Value " + out.code + " = rt::empty_array();");
+  for (auto a : tree.children(root)) {
+    line("rt::dimension(" + out.code + ", " + compute(a).code + ", " +
+         line_number + ");");
+  }
+  line("rt::zeros(" + out.code + ");");
+  return out;
+}
+
+// the indices of an accessor, a single one is passed as it is
+std::string CppEmitter::keys(ast::node accessor) {
+  std::vector<std::string> out;
+  for (auto a : tree.children(accessor)) {
+    out.push_back(compute(a).code);
+  }
+  if (out.size() == 1) return out[0];
+  return "std::initializer_list<rt::Value>{" + join(out) + "}";
+}
+
+CppEmitter::Operand CppEmitter::std_return(ast::node root) {
+  std::string call;
+  switch (tree[tree.children(root).back()].token) {
+    case tk::LENGTH:
+      call = "rt::length(";
+      break;
+    case tk::POP:
+      call = "rt::pop(";
+      break;
+    case tk::DEQUEUE:
+      call = "rt::dequeue(";
+      break;
+    case tk::GET_NEXT:
+      call = "rt::get_next(";
+      break;
+    case tk::HAS_NEXT:
+      call = "rt::has_next(";
+      break;
+    case tk::IS_EMPTY:
+      call = "rt::is_empty(";
+      break;
+    default:
+      unexpected(root);
+      return {"rt::Value()", CONSTANT};
+  }
+  Operand out{temp("t"), TEMPORARY};
+  line("rt::Value " + out.code + " = " + call + variable(root) + ", " +
+       std::to_string(tree[root].line) + ", " + name(root) + ");");
+  return out;
+}
+
+// The C++ condition, computed into a bool when it needs computing. 'AND' and
+// 'OR' compute their right side only when it decides; anything but a
+// comparison or 'AND' and 'OR' of them is false.
+std::string CppEmitter::condition(ast::node root) {
+  if (tree[root].id == ast::COND &&
+      (tree[root].token == tk::AND || tree[root].token == tk::OR)) {
+    bool conjunction = tree[root].token == tk::AND;
+    std::string l = condition(tree.child(root, 0));
+    if (l == "false")
+      return conjunction ? l : condition(tree.child(root, 1));
+    line(std::string("if (") + (conjunction ? "" : "!") + l + ") {");
+    ++depth;
+    line(l + " = " + condition(tree.child(root, 1)) + ";");
+    --depth;
+    line("}");
+    return l;
+  }
+  if (tree[root].id == ast::CMP) {
+    Operand l = compute(tree.child(root, 0));
+    Operand r = compute(tree.child(root, 1));
+    std::string out = temp("c");
+    line("bool " + out + " = rt::compare<" + op_name(tree[root].token) +
+         ">(" + l.code + ", " + r.code + ", " +
+         std::to_string(tree[root].line) + ");");
+    return out;
+  }
+  return "false";
+}
+
+}  // namespace IBPCI
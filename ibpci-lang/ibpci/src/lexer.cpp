@@ -2,17 +2,185 @@
 
 namespace lxr {
 
-Lexer::Lexer(std::string buffer) : input_buffer(buffer) {
-  pos = 0, len = input_buffer.size();
-  c = input_buffer.at(pos);
+namespace {
+
+// The lexer is a DFA over classes of characters. Every token is scanned by
+// following transitions from START until one leads to DONE, the state it
+// stops in tells what was read. Both tables are built at compile time.
+
+enum char_class : std::uint8_t {
+  END,
+  SPACE,
+  NEWLINE,
+  DIGIT,
+  UPPER,
+  LOWER,
+  UNDERSCORE,
+  DOT,
+  QUOTE,
+  SLASH,
+  EQUALS,
+  LESS,
+  GREATER,
+  BANG,
+  SINGLE,
+  EOF_BYTE,
+  OTHER,
+  CLASSES
+};
+
+enum state : std::uint8_t {
+  START,
+  WHITESPACE,
+  LINE_BREAK,
+  INTEGER,
+  FRACTION,
+  VARIABLE,
+  METHOD_NAME,
+  STRING,
+  CLOSED_STRING,
+  DIVIDE,
+  COMMENT,
+  ASSIGN,
+  IS,
+  LT,
+  LEQ,
+  GT,
+  GEQ,
+  NOT,
+  DNEQ,
+  OPERATOR,
+  DONE,
+  STATES
+};
+
+constexpr std::array<std::uint8_t, 256> char_classes() {
+  std::array<std::uint8_t, 256> classes{};
+  for (auto &a : classes) a = OTHER;
+  for (int c = '0'; c <= '9'; ++c) classes[c] = DIGIT;
+  for (int c = 'A'; c <= 'Z'; ++c) classes[c] = UPPER;
+  for (int c = 'a'; c <= 'z'; ++c) classes[c] = LOWER;
+  for (char c : {' ', '\t', '\v', '\f'}) classes[(unsigned char)c] = SPACE;
+  for (char c : {'+', '-', '*', '%', '[', ']', '(', ')', ','})
+    classes[(unsigned char)c] = SINGLE;
+  classes['\n'] = NEWLINE;
+  classes['_'] = UNDERSCORE;
+  classes['.'] = DOT;
+  classes['"'] = QUOTE;
+  classes['/'] = SLASH;
+  classes['='] = EQUALS;
+  classes['<'] = LESS;
+  classes['>'] = GREATER;
+  classes['!'] = BANG;
+  // the byte that reads as EOF through a char, it ends the source outside of
+  // strings and comments and closes a string
+  classes[0xff] = EOF_BYTE;
+  return classes;
+}
+
+constexpr std::array<std::array<std::uint8_t, CLASSES>, STATES> transitions() {
+  std::array<std::array<std::uint8_t, CLASSES>, STATES> next{};
+  for (auto &row : next)
+    for (auto &a : row) a = DONE;
+  next[START][SPACE] = WHITESPACE;
+  next[START][NEWLINE] = LINE_BREAK;
+  next[START][DIGIT] = INTEGER;
+  next[START][UPPER] = VARIABLE;
+  next[START][LOWER] = METHOD_NAME;
+  next[START][DOT] = OPERATOR;
+  next[START][QUOTE] = STRING;
+  next[START][SLASH] = DIVIDE;
+  next[START][EQUALS] = ASSIGN;
+  next[START][LESS] = LT;
+  next[START][GREATER] = GT;
+  next[START][BANG] = NOT;
+  next[START][SINGLE] = OPERATOR;
+  next[WHITESPACE][SPACE] = WHITESPACE;
+  next[INTEGER][DIGIT] = INTEGER;
+  next[INTEGER][DOT] = FRACTION;
+  next[FRACTION][DIGIT] = FRACTION;
+  // identifiers made of capitals, digits and underscores are variables
+  for (auto c : {UPPER, DIGIT, UNDERSCORE}) next[VARIABLE][c] = VARIABLE;
+  next[VARIABLE][LOWER] = METHOD_NAME;
+  for (auto c : {UPPER, LOWER, DIGIT, UNDERSCORE})
+    next[METHOD_NAME][c] = METHOD_NAME;
+  for (int c = SPACE; c < CLASSES; ++c) next[STRING][c] = STRING;
+  next[STRING][QUOTE] = CLOSED_STRING;
+  next[STRING][EOF_BYTE] = CLOSED_STRING;
+  next[DIVIDE][SLASH] = COMMENT;
+  for (int c = SPACE; c < CLASSES; ++c) next[COMMENT][c] = COMMENT;
+  next[COMMENT][NEWLINE] = DONE;
+  next[ASSIGN][EQUALS] = IS;
+  next[LT][EQUALS] = LEQ;
+  next[GT][EQUALS] = GEQ;
+  next[NOT][EQUALS] = DNEQ;
+  return next;
+}
+
+constexpr std::array<std::uint8_t, 256> CHAR_CLASSES = char_classes();
+constexpr std::array<std::array<std::uint8_t, CLASSES>, STATES> TRANSITIONS =
+    transitions();
+
+// token ids of the states that end in a token of a fixed kind
+constexpr std::array<std::uint8_t, STATES> accepted_ids() {
+  std::array<std::uint8_t, STATES> ids{};
+  ids[DIVIDE] = tk::DIV_WOQ;
+  ids[ASSIGN] = tk::EQ;
+  ids[IS] = tk::IS;
+  ids[LT] = tk::LT;
+  ids[LEQ] = tk::LEQ;
+  ids[GT] = tk::GT;
+  ids[GEQ] = tk::GEQ;
+  ids[DNEQ] = tk::DNEQ;
+  return ids;
+}
+
+constexpr std::array<std::uint8_t, 256> operator_ids() {
+  std::array<std::uint8_t, 256> ids{};
+  ids['+'] = tk::PLUS;
+  ids['-'] = tk::MINUS;
+  ids['*'] = tk::MULT;
+  ids['%'] = tk::MOD;
+  ids['['] = tk::LSQBR;
+  ids[']'] = tk::RSQBR;
+  ids['('] = tk::LPAREN;
+  ids[')'] = tk::RPAREN;
+  ids['.'] = tk::DOT;
+  ids[','] = tk::COMMA;
+  return ids;
+}
+
+constexpr std::array<std::uint8_t, STATES> ACCEPTED_IDS = accepted_ids();
+constexpr std::array<std::uint8_t, 256> OPERATOR_IDS = operator_ids();
+
+// a piece of the source that ends in a line break, lexed on its own as if it
+// began at line 1 and outside of a string
+struct Chunk {
+  std::uint32_t begin;
+  std::uint32_t end;
+  Tokens tokens;
+  unsigned lines{0};
+};
+
+}  // namespace
+
+Lexer::Lexer(std::string_view source) : source(source) {
+  pos = 0;
+  end = source.size();
   line_num = 1;
 }
 
-int is_upcase(char c) {
-  return (c >= 'A' && c <= 'Z') || isdigit(c) || c == '_' ? 1 : 0;
+Lexer::Lexer(std::string_view source, std::uint32_t begin, std::uint32_t end,
+             unsigned line)
+    : source(source), pos(begin), end(end) {
+  line_num = line;
+}
+
+Lexer::Lexer(std::istream &in, std::size_t chunk) : in(&in), chunk(chunk) {
+  line_num = 1;
 }
 
-void Lexer::set_error() {
+void Lexer::set_error(char c) {
   current_error.message = "Unexpected character at line " +
                           std::to_string(line_num) + ": '" + c + "'\n";
   current_error.line_num = line_num;
@@ -20,213 +188,283 @@ void Lexer::set_error() {
   error_flag = true;
 }
 
-Error Lexer::get_error() { return current_error; }
+Error Lexer::get_error() const { return current_error; }
 
-void Lexer::advance() {
-  pos++;
-  if (pos < len - 1) {
-    c = input_buffer.at(pos);
-  } else {
-    c = EOF;
+// follows the transitions from START from pos on, returns the state the token
+// ends in and leaves pos behind it; start is where the token begins
+int Lexer::scan(std::uint32_t &start) {
+  std::uint8_t state = START;
+  while (true) {
+    std::uint8_t c = pos < end || refill(start)
+                         ? CHAR_CLASSES[(unsigned char)source[pos]]
+                         : (std::uint8_t)END;
+    std::uint8_t next = TRANSITIONS[state][c];
+    if (next == DONE) return state;
+    state = next;
+    ++pos;
   }
 }
 
-void Lexer::skip_whitespace() {
-  while (c == ' ' || c == '\t' || c == '\v' || c == '\f') {
-    advance();
-  }
+// streaming: drops what was read before the token that begins at start,
+// appends the next chunk and moves start and pos along; false once the input
+// is exhausted
+bool Lexer::refill(std::uint32_t &start) {
+  if (in == nullptr || !*in) return false;
+  window.erase(0, start);
+  pos -= start;
+  start = 0;
+  std::size_t kept = window.size();
+  window.resize(kept + chunk);
+  in->read(&window[kept], chunk);
+  window.resize(kept + in->gcount());
+  source = window;
+  end = window.size();
+  return pos < end;
 }
 
-void Lexer::skip_comment() {
-  while (c != '\n') {
-    advance();
-  }
+// literals without a fraction are INT while a double holds them exactly
+void Lexer::number(tk::Span &span) {
+  span.id = tk::NUM;
+  if (span.num_type != tk::INT) return;
+  std::int64_t value;
+  std::string_view digits = text(span);
+  auto result =
+      std::from_chars(digits.data(), digits.data() + digits.size(), value);
+  if (result.ec != std::errc() || value > 9007199254740992)
+    span.num_type = tk::FLOAT;
 }
 
-tk::Token Lexer::number() {
-  int id = tk::INT;
-  std::string buffer;
-  buffer.push_back(c);
-  advance();
-  while (std::isdigit(c) || c == '.') {
-    if (c == '.' && id == tk::FLOAT) break;
-    if (c == '.') id = tk::FLOAT;
-    buffer.push_back(c);
-    advance();
+// scans the next token without copying it out of the source, span is left
+// as it was when the source has an unexpected character
+int Lexer::next_span(tk::Span &span) {
+  tk::Span next;
+  while (!error_flag) {
+    next.offset = pos;
+    next.num_type = tk::FLOAT;
+    next.line = line_num;
+    int state = scan(next.offset);
+    next.length = pos - next.offset;
+    switch (state) {
+      case WHITESPACE:
+      case COMMENT:
+        continue;
+      case LINE_BREAK:
+        ++line_num;
+        continue;
+      case INTEGER:
+        next.num_type = tk::INT;
+        number(next);
+        break;
+      case FRACTION:
+        number(next);
+        break;
+      case VARIABLE:
+      case METHOD_NAME:
+        next.id = tk::lookup_keyword(text(next));
+        if (next.id == 0)
+          next.id = state == VARIABLE ? tk::ID_VAR : tk::ID_METHOD;
+        break;
+      // the span covers the contents between the quotes
+      case CLOSED_STRING:
+        next.length--;
+        [[fallthrough]];
+      case STRING:
+        next.offset++;
+        next.length--;
+        next.id = tk::STRING;
+        break;
+      case OPERATOR:
+        next.id = OPERATOR_IDS[(unsigned char)source[next.offset]];
+        break;
+      // stuck before the first character or after a '!'
+      case START:
+      case NOT: {
+        char c = pos < end ? source[pos] : (char)EOF;
+        if (state == START && c == (char)EOF) {
+          next.id = tk::END_FILE;
+          break;
+        }
+        // a '!' without '=' has always left an empty token behind
+        if (state == NOT) span.id = tk::END_FILE;
+        set_error(c);
+        return 0;
+      }
+      default:
+        next.id = ACCEPTED_IDS[state];
+    }
+    DIAGNOSE(TRACE, LEXER,
+             "line " << next.line << ": " << tk::id_to_str(next.id) << " '"
+                     << text(next) << "'");
+    span = next;
+    return 1;
   }
-  return tk::Token(tk::NUM, std::stod(buffer), line_num);
+  return 0;
 }
 
-tk::Token Lexer::id() {
-  int id = tk::ID_VAR;
-  int keyword_id = 0;
-  attr_buffer.push_back(c);
-  if (!is_upcase(c)) {
-    id = tk::ID_METHOD;
+void Tokens::reserve(std::size_t count) {
+  ids.reserve(count);
+  num_types.reserve(count);
+  offsets.reserve(count);
+  lengths.reserve(count);
+  lines.reserve(count);
+  values.reserve(count);
+}
+
+void Tokens::push(const tk::Span &span, double value) {
+  ids.push_back(span.id);
+  num_types.push_back(span.num_type);
+  offsets.push_back(span.offset);
+  lengths.push_back(span.length);
+  lines.push_back(span.line);
+  values.push_back(value);
+}
+
+void Tokens::pop() {
+  ids.pop_back();
+  num_types.pop_back();
+  offsets.pop_back();
+  lengths.pop_back();
+  lines.pop_back();
+  values.pop_back();
+}
+
+void Tokens::append(const Tokens &piece, unsigned lines) {
+  ids.insert(ids.end(), piece.ids.begin(), piece.ids.end());
+  num_types.insert(num_types.end(), piece.num_types.begin(),
+                   piece.num_types.end());
+  offsets.insert(offsets.end(), piece.offsets.begin(), piece.offsets.end());
+  lengths.insert(lengths.end(), piece.lengths.begin(), piece.lengths.end());
+  for (auto line : piece.lines) this->lines.push_back(line + lines);
+  values.insert(values.end(), piece.values.begin(), piece.values.end());
+}
+
+// lexes the rest of the source into tokens, up to the end of the file or the
+// first error; a token that was already there is what an error leaves behind
+void Lexer::tokenize(Tokens &tokens, unsigned threads) {
+#ifndef __EMSCRIPTEN__
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  // traces of the lexer come in source order
+  if (in == nullptr && threads > 1 && end - pos >= PARALLEL_MIN &&
+      !dg::enabled(dg::TRACE, dg::LEXER)) {
+    tokenize_parallel(tokens, threads);
+    return;
   }
-  advance();
-  while (std::isalnum(c) || c == '_') {
-    if (!is_upcase(c)) {
-      id = tk::ID_METHOD;
-    }
-    attr_buffer.push_back(c);
-    advance();
+#endif
+  tk::Span span;
+  if (tokens.size() > 0) span = tokens.span(tokens.size() - 1);
+  // about one token per two bytes of source, the pages of what is not used
+  // are never touched
+  tokens.reserve(tokens.size() + (end - pos) / 2 + 1);
+  while (next_span(span)) {
+    tokens.push(span, span.id == tk::NUM ? value(span) : 0);
+    if (span.id == tk::END_FILE) return;
   }
-  keyword_id = tk::lookup_keyword(attr_buffer);
-  id = keyword_id > 0 ? keyword_id : id;
-  return tk::Token(id, attr_buffer, line_num);
+  tokens.push(span, 0);
+  tokens.failed = true;
+  tokens.error = current_error;
 }
 
-tk::Token Lexer::string() {
-  advance();
-  while (c != '\"' && c != EOF) {
-    attr_buffer.push_back(c);
-    advance();
+// Only a string can run over a line break, so the lexer is between tokens
+// after every line break outside of strings. The source is split after line
+// breaks and every chunk is lexed on its own on the assumption that it starts
+// there; the chunks are then stitched in order. One that starts inside a
+// string, or that failed and needs its error at the right line, is lexed again
+// from where the lexer really is, which is usually the quote before it.
+void Lexer::tokenize_parallel(Tokens &tokens, unsigned threads) {
+#ifndef __EMSCRIPTEN__
+  std::vector<Chunk> chunks;
+  std::uint32_t size = (end - pos) / (threads * 4) + 1;
+  for (std::uint32_t begin = pos; begin < end;) {
+    std::uint32_t split = end - begin > size ? begin + size : end;
+    while (split < end && source[split - 1] != '\n') ++split;
+    chunks.push_back({begin, split, {}});
+    begin = split;
   }
-  advance();
-  return tk::Token(tk::STRING, attr_buffer, line_num);
-}
-
-tk::Token Lexer::equals_operator(char base_character) {
-  advance();
-  if (c == '=') {
-    switch (base_character) {
-      case '=':
-        advance();
-        attr_buffer = "==";
-        return tk::Token(tk::IS, attr_buffer, line_num);
-      case '<':
-        advance();
-        attr_buffer = "<=";
-        return tk::Token(tk::LEQ, attr_buffer, line_num);
-      case '>':
-        advance();
-        attr_buffer = ">=";
-        return tk::Token(tk::GEQ, attr_buffer, line_num);
-      case '!':
-        advance();
-        attr_buffer = "!=";
-        return tk::Token(tk::DNEQ, attr_buffer, line_num);
+
+  std::atomic<std::size_t> next{0};
+  auto work = [&]() {
+    for (std::size_t i; (i = next++) < chunks.size();) {
+      Lexer lex(source, chunks[i].begin, chunks[i].end, 1);
+      lex.tokenize(chunks[i].tokens, 1);
+      chunks[i].lines = lex.line_num - 1;
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned i = 1; i < threads; ++i) pool.emplace_back(work);
+  work();
+  for (auto &thread : pool) thread.join();
+
+  std::size_t count = tokens.size();
+  for (auto &chunk : chunks) count += chunk.tokens.size();
+  tokens.reserve(count);
+  std::uint32_t from = pos;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    Chunk &chunk = chunks[i];
+    if (from == chunk.begin && !chunk.tokens.failed) {
+      tokens.append(chunk.tokens, line_num - 1);
+      line_num += chunk.lines;
+    } else {
+      Lexer lex(source, from, chunk.end, line_num);
+      lex.tokenize(tokens, 1);
+      line_num = lex.line_num;
     }
-  } else {
-    switch (base_character) {
-      case '=':
-        attr_buffer = "=";
-        return tk::Token(tk::EQ, attr_buffer, line_num);
-      case '<':
-        attr_buffer = "<";
-        return tk::Token(tk::LT, attr_buffer, line_num);
-      case '>':
-        attr_buffer = ">";
-        return tk::Token(tk::GT, attr_buffer, line_num);
+    chunk.tokens = Tokens();
+    pos = chunk.end;
+    std::size_t last = tokens.size() - 1;
+    if (tokens.failed) {
+      current_error = tokens.error;
+      error_flag = true;
+      return;
+    }
+    // the end of the chunk is not the end of the source, unless an EOF byte
+    // came before it
+    if (tokens.offsets[last] < chunk.end || i + 1 == chunks.size()) return;
+    tokens.pop();
+    --last;
+    from = chunk.end;
+    // a string still open at the end of the chunk goes on in the next one
+    if (tokens.size() > 0 && tokens.ids[last] == tk::STRING &&
+        tokens.offsets[last] + tokens.lengths[last] == chunk.end) {
+      from = tokens.offsets[last] - 1;
+      tokens.pop();
     }
   }
-  set_error();
-  return tk::Token();
+#endif
 }
 
-int Lexer::get_next_token(tk::Token &token) {
-  std::cout << "dupa" << std::endl;
-  while (!error_flag && c != EOF) {
-    skip_whitespace();
-    attr_buffer.clear();
-    if (std::isdigit(c)) {
-      token = number();
-      return !error_flag;
-    } else if (std::isalnum(c)) {
-      token = id();
-      return !error_flag;
-    } else {
-      switch (c) {
-        case '+':
-          advance();
-          attr_buffer = "+";
-          token = tk::Token(tk::PLUS, attr_buffer, line_num);
-          return !error_flag;
-        case '-':
-          advance();
-          attr_buffer = "-";
-          token = tk::Token(tk::MINUS, attr_buffer, line_num);
-          return !error_flag;
-        case '*':
-          advance();
-          attr_buffer = "*";
-          token = tk::Token(tk::MULT, attr_buffer, line_num);
-        case '%':
-          advance();
-          attr_buffer = "%";
-          token = tk::Token(tk::MOD, attr_buffer, line_num);
-        case '[':
-          advance();
-          attr_buffer = "]";
-          token = tk::Token(tk::LSQBR, attr_buffer, line_num);
-          return !error_flag;
-        case ']':
-          advance();
-          attr_buffer = "]";
-          token = tk::Token(tk::RSQBR, attr_buffer, line_num);
-          return !error_flag;
-        case '(':
-          advance();
-          attr_buffer = "(";
-          token = tk::Token(tk::LPAREN, attr_buffer, line_num);
-          return !error_flag;
-        case ')':
-          advance();
-          attr_buffer = ")";
-          token = tk::Token(tk::RPAREN, attr_buffer, line_num);
-          return !error_flag;
-        case '.':
-          advance();
-          attr_buffer = ".";
-          token = tk::Token(tk::DOT, attr_buffer, line_num);
-          return !error_flag;
-        case ',':
-          advance();
-          attr_buffer = ",";
-          token = tk::Token(tk::COMMA, attr_buffer, line_num);
-          return !error_flag;
-        case '\"':
-          token = string();
-          return !error_flag;
-        case '=':
-          token = equals_operator('=');
-          return !error_flag;
-        case '>':
-          token = equals_operator('>');
-          return !error_flag;
-        case '<':
-          token = equals_operator('<');
-          return !error_flag;
-        case '!':
-          token = equals_operator('!');
-          return !error_flag;
-        case '/':
-          advance();
-          if (c == '/') {
-            skip_comment();
-            break;
-          } else {
-            attr_buffer = "/";
-            token = tk::Token(tk::DIV_WOQ, attr_buffer, line_num);
-            return !error_flag;
-          }
-        case '\n':
-          advance();
-          ++line_num;
-          break;
-        case EOF:
-          attr_buffer = "EOF";
-          token = tk::Token(tk::END_FILE, attr_buffer, line_num);
-          return !error_flag;
-        default:
-          set_error();
-          return !error_flag;
-      }
-    }
+double Lexer::value(const tk::Span &span) const {
+  double value = 0;
+  std::string_view digits = text(span);
+  std::from_chars(digits.data(), digits.data() + digits.size(), value);
+  return value;
+}
+
+// the text tokens have always carried, which is not the source text for the
+// end of the file and for '['
+std::string_view Lexer::lexeme(const tk::Span &span) const {
+  switch (span.id) {
+    case tk::LSQBR:
+      return "]";
+    case tk::END_FILE:
+      return "EOF";
+    default:
+      return text(span);
   }
+}
 
-  return !error_flag;
+tk::Token Lexer::to_token(const tk::Span &span) const {
+  if (span.id != tk::NUM)
+    return tk::Token(span.id, std::string(lexeme(span)), span.line);
+  tk::Token out(tk::NUM, value(span), span.line);
+  out.num_type = span.num_type;
+  return out;
+}
+
+int Lexer::get_next_token(tk::Token &token) {
+  tk::Span span;
+  if (!next_span(span)) return 0;
+  token = to_token(span);
+  return 1;
 }
 
 }  // namespace lxr
@@ -0,0 +1,744 @@
+#include "../include/optimizer.hpp"
+
+namespace opt {
+
+namespace {
+
+// integers a double in the number pool of the tree holds exactly
+const std::int64_t EXACT = std::int64_t(1) << 53;
+
+// passes at -O2 run again until nothing changes, or this many times
+const unsigned ROUNDS = 8;
+
+bool statement(int id) {
+  switch (id) {
+    case ast::ASSIGN:
+    case ast::STD_VOID:
+    case ast::IF:
+    case ast::WHILE:
+    case ast::FOR:
+    case ast::METHOD_CALL:
+    case ast::OUTPUT:
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+PassManager::PassManager(ast::Tree &tree, rsv::scopes &scopes,
+                         unsigned level)
+    : tree(tree), scopes(scopes), level(level) {
+  passes = {
+      {"constant folding", "nodes folded", 1, &PassManager::fold, 0},
+      {"constant propagation", "reads replaced", 2, &PassManager::propagate,
+       0},
+      {"constant conditions", "branches and operands removed", 1,
+       &PassManager::conditions, 0},
+      {"unreachable code", "statements removed", 1, &PassManager::unreachable,
+       0},
+      {"loop-invariant code motion", "expressions hoisted", 2,
+       &PassManager::hoist, 0},
+  };
+}
+
+// main and every method that has its body, methods are declared in main only
+void PassManager::run() {
+  if (level == 0) return;
+  std::vector<ast::node> bodies{tree.root};
+  for (auto a : tree.children(tree.root)) {
+    if (tree[a].id == ast::METHOD && !tree.children(a).empty() &&
+        tree[tree.children(a).back()].id == ast::BLOCK)
+      bodies.push_back(a);
+  }
+  for (unsigned round = 0; round < (level > 1 ? ROUNDS : 1); ++round) {
+    unsigned changes = 0;
+    for (auto &pass : passes) {
+      if (pass.level > level) continue;
+      for (auto body : bodies) {
+        unsigned count = (this->*pass.run)(body);
+        pass.changes += count;
+        changes += count;
+      }
+    }
+    if (changes == 0) break;
+  }
+}
+
+void PassManager::print_stats(std::ostream &out) {
+  for (auto &pass : passes) {
+    if (pass.level > level) continue;
+    out << pass.name << ": " << pass.changes << " " << pass.unit << std::endl;
+  }
+}
+
+// the node whose children are the statements of main or of a method
+ast::node PassManager::statements(ast::node body) {
+  if (body == tree.root) return body;
+  return tree.children(body).back();
+}
+
+// the new children go to the end of kids, the old range is left unused
+void PassManager::set_children(ast::node n,
+                               const std::vector<ast::node> &children) {
+  tree[n].first = tree.kids.size();
+  tree[n].count = children.size();
+  tree.kids.insert(tree.kids.end(), children.begin(), children.end());
+}
+
+bool PassManager::literal(ast::node n, val::Value &out) {
+  if (tree[n].id == ast::NUM) {
+    out = val::number(tree.num(n), tree[n].num_type);
+    return true;
+  }
+  if (tree[n].id == ast::STRING) {
+    out = val::Value(tree.str(n));
+    return true;
+  }
+  return false;
+}
+
+// turns n into the literal of value, which keeps the line of n
+bool PassManager::make_literal(ast::node n, const val::Value &value) {
+  ast::Node &x = tree[n];
+  if (value.kind == val::INT) {
+    if (value.i > EXACT || value.i < -EXACT) return false;
+    x.payload = tree.numbers.size();
+    tree.numbers.push_back((double)value.i);
+    x.num_type = tk::INT;
+  } else if (value.kind == val::NUM) {
+    x.payload = tree.numbers.size();
+    tree.numbers.push_back(value.num);
+    x.num_type = tk::FLOAT;
+  } else if (value.kind == val::STR) {
+    x.payload = tree.strings.size();
+    tree.strings.push_back(value.str());
+  } else {
+    return false;
+  }
+  x.id = value.kind == val::STR ? ast::STRING : ast::NUM;
+  x.token = value.kind == val::STR ? tk::STRING : tk::NUM;
+  x.is_terminal = true;
+  x.count = 0;
+  return true;
+}
+
+// a block whose statements run the same way among the statements of the
+// block or of main around it
+bool PassManager::spliceable(ast::node block) {
+  for (auto a : tree.children(block)) {
+    if (!statement(tree[a].id)) return false;
+  }
+  return true;
+}
+
+unsigned PassManager::fold(ast::node body) {
+  return fold_tree(statements(body));
+}
+
+// children first, so that a literal folded below is folded on up
+unsigned PassManager::fold_tree(ast::node n) {
+  if (n == ast::NONE || tree[n].id == ast::METHOD) return 0;
+  unsigned changes = 0;
+  for (auto a : tree.children(n)) {
+    changes += fold_tree(a);
+  }
+  switch (tree[n].id) {
+    case ast::BINOP:
+    case ast::NUM_BINOP:
+    case ast::STR_CONCAT:
+      return changes + fold_binop(n);
+    case ast::UN_MIN:
+      return changes + fold_negative(n);
+  }
+  return changes;
+}
+
+bool PassManager::fold_binop(ast::node n) {
+  val::Value l, r, out;
+  if (!literal(tree.child(n, 0), l) || !literal(tree.child(n, 1), r))
+    return false;
+  int op = tree[n].token;
+  if (l.is_number() && r.is_number()) {
+    switch (op) {
+      case tk::PLUS:
+        out = val::add(l, r);
+        break;
+      case tk::MINUS:
+        out = val::subtract(l, r);
+        break;
+      case tk::MULT:
+        out = val::multiply(l, r);
+        break;
+      case tk::DIV_WOQ:
+        if (val::to_double(r) == 0) return false;
+        out = val::divide(l, r);
+        break;
+      case tk::DIV_WQ:
+        if (val::to_int(r) == 0) return false;
+        out = val::divide_int(l, r);
+        break;
+      case tk::MOD:
+        if (val::to_int(r) == 0) return false;
+        out = val::modulo(l, r);
+        break;
+      default:
+        return false;
+    }
+  } else if (l.kind == val::STR && r.kind == val::STR && op == tk::PLUS) {
+    out = val::Value(l.str() + r.str());
+  } else {
+    return false;
+  }
+  return make_literal(n, out);
+}
+
+bool PassManager::fold_negative(ast::node n) {
+  val::Value v;
+  if (!literal(tree.child(n, 0), v) || !v.is_number()) return false;
+  return make_literal(n, val::negate(v));
+}
+
+// a variable written once, by an assignment of a literal at the top level of
+// its body, holds the literal in every statement after the assignment; the
+// parameters of a method are written by its calls
+unsigned PassManager::propagate(ast::node body) {
+  std::map<int, unsigned> writes;
+  ast::node list = statements(body);
+  unsigned changes = 0;
+  if (body != tree.root && tree[tree.child(body, 0)].id == ast::PARAM) {
+    for (auto a : tree.children(tree.child(body, 0))) {
+      ++writes[tree[a].slot];
+    }
+  }
+  count_writes(list, writes);
+  ast::Children children = tree.children(list);
+  for (unsigned i = 0; i < children.size(); ++i) {
+    ast::node a = children[i];
+    if (tree[a].id != ast::ASSIGN) continue;
+    ast::node target = tree.child(a, 0);
+    ast::node value = tree.child(a, 1);
+    if (tree[target].id != ast::ID || writes[tree[target].slot] != 1 ||
+        (tree[value].id != ast::NUM && tree[value].id != ast::STRING))
+      continue;
+    for (unsigned j = i + 1; j < children.size(); ++j) {
+      changes += replace_reads(children[j], tree[target].slot, value);
+    }
+  }
+  return changes;
+}
+
+void PassManager::count_writes(ast::node n, std::map<int, unsigned> &writes) {
+  if (n == ast::NONE) return;
+  switch (tree[n].id) {
+    case ast::METHOD:
+      return;
+    case ast::ASSIGN:
+      if (tree[tree.child(n, 0)].id != ast::ARR_ACC)
+        ++writes[tree[tree.child(n, 0)].slot];
+      break;
+    case ast::RANGE:
+      ++writes[tree[tree.child(n, 0)].slot];
+      break;
+  }
+  for (auto a : tree.children(n)) {
+    count_writes(a, writes);
+  }
+}
+
+// the targets of assignments and counting loops are written, not read
+unsigned PassManager::replace_reads(ast::node n, int slot, ast::node value) {
+  if (n == ast::NONE) return 0;
+  unsigned changes = 0;
+  switch (tree[n].id) {
+    case ast::METHOD:
+      return 0;
+    case ast::ID:
+      if (tree[n].slot != slot) return 0;
+      tree[n].id = tree[value].id;
+      tree[n].token = tree[value].token;
+      tree[n].num_type = tree[value].num_type;
+      tree[n].is_terminal = true;
+      tree[n].payload = tree[value].payload;
+      tree[n].count = 0;
+      return 1;
+    case ast::ASSIGN: {
+      ast::node target = tree.child(n, 0);
+      changes += replace_reads(tree.child(n, 1), slot, value);
+      if (tree[target].id == ast::ARR_ACC) {
+        for (auto a : tree.children(target)) {
+          changes += replace_reads(a, slot, value);
+        }
+      }
+      return changes;
+    }
+    case ast::RANGE:
+      changes += replace_reads(tree.child(n, 1), slot, value);
+      return changes + replace_reads(tree.child(n, 2), slot, value);
+  }
+  for (auto a : tree.children(n)) {
+    changes += replace_reads(a, slot, value);
+  }
+  return changes;
+}
+
+unsigned PassManager::conditions(ast::node body) {
+  return branches(statements(body));
+}
+
+// the statements of main or of a block with the if statements and while
+// loops that have known conditions taken apart
+unsigned PassManager::branches(ast::node parent) {
+  unsigned changes = 0;
+  std::vector<ast::node> out;
+  ast::Children children = tree.children(parent);
+  for (auto a : children) {
+    switch (tree[a].id) {
+      case ast::IF:
+        changes += exec_if(a, out);
+        break;
+      case ast::WHILE: {
+        ast::node cond = reduce(tree.child(a, 0), changes);
+        tree.kids[tree[a].first] = cond;
+        if (truth(cond) == 0) {
+          ++changes;
+          break;
+        }
+        changes += branches(tree.child(a, 1));
+        out.push_back(a);
+        break;
+      }
+      case ast::FOR:
+        changes += branches(tree.child(a, 1));
+        out.push_back(a);
+        break;
+      default:
+        out.push_back(a);
+    }
+  }
+  bool same = out.size() == children.size();
+  for (unsigned i = 0; same && i < out.size(); ++i) {
+    same = out[i] == children[i];
+  }
+  if (!same) set_children(parent, out);
+  return changes;
+}
+
+// The arms whose conditions are false are dropped, so are the ones after an
+// arm whose condition is true, which becomes the else. What is left of the
+// statement goes to out: nothing, the statements of the block that always
+// runs, or the if statement with the arms that may run.
+unsigned PassManager::exec_if(ast::node root, std::vector<ast::node> &out) {
+  unsigned changes = 0;
+  std::vector<Arm> arms{{root, tree.child(root, 0), tree.child(root, 1)}};
+  ast::node otherwise = ast::NONE;
+  for (unsigned i = 2; i < tree.children(root).size(); ++i) {
+    ast::node n = tree.child(root, i);
+    if (tree[n].id == ast::ELIF)
+      arms.push_back({n, tree.child(n, 0), tree.child(n, 1)});
+    else if (tree[n].id == ast::ELSE)
+      otherwise = n;
+  }
+  unsigned before = arms.size() + (otherwise != ast::NONE);
+
+  std::vector<Arm> kept;
+  ast::node last = ast::NONE, block = ast::NONE;
+  for (auto &arm : arms) {
+    arm.cond = reduce(arm.cond, changes);
+    tree.kids[tree[arm.root].first] = arm.cond;
+    changes += branches(arm.block);
+    int known = truth(arm.cond);
+    if (known == 0) continue;
+    if (known == 1) {
+      last = arm.root;
+      block = arm.block;
+      break;
+    }
+    kept.push_back(arm);
+  }
+  if (last == ast::NONE && otherwise != ast::NONE) {
+    block = tree.child(otherwise, 0);
+    changes += branches(block);
+    last = otherwise;
+  }
+
+  if (kept.empty()) {
+    if (last == ast::NONE) return changes + before;
+    if (!spliceable(block)) {
+      out.push_back(root);
+      return changes;
+    }
+    for (auto a : tree.children(block)) {
+      out.push_back(a);
+    }
+    return changes + before;
+  }
+  unsigned after = kept.size() + (last != ast::NONE);
+  if (after == before) {
+    out.push_back(root);
+    return changes;
+  }
+  // an arm whose condition is true is the else of the arms before it
+  if (last != ast::NONE && tree[last].id == ast::ELIF) {
+    tree[last].id = ast::ELSE;
+    tree[last].first += 1;
+    tree[last].count = 1;
+  }
+  std::vector<ast::node> children{kept[0].cond, kept[0].block};
+  for (unsigned i = 1; i < kept.size(); ++i) {
+    children.push_back(kept[i].root);
+  }
+  if (last != ast::NONE) children.push_back(last);
+  set_children(root, children);
+  out.push_back(root);
+  return changes + before - after;
+}
+
+// a COND with an operand that is known is the other operand, or the known
+// one when that decides it; the operands of AND and OR are conditions
+ast::node PassManager::reduce(ast::node cond, unsigned &changes) {
+  if (tree[cond].id != ast::COND ||
+      (tree[cond].token != tk::AND && tree[cond].token != tk::OR))
+    return cond;
+  std::uint32_t first = tree[cond].first;
+  ast::node l = tree.kids[first] = reduce(tree.kids[first], changes);
+  ast::node r = tree.kids[first + 1] = reduce(tree.kids[first + 1], changes);
+  int known = tree[cond].token == tk::AND ? 1 : 0;
+  if (truth(l) == known) {
+    ++changes;
+    return r;
+  }
+  // the left operand is computed whatever the right one is
+  if (truth(r) == known) {
+    ++changes;
+    return l;
+  }
+  return cond;
+}
+
+// 1 or 0 for a condition known without computing anything, -1 otherwise;
+// the interpreter takes anything but COND and CMP for false
+int PassManager::truth(ast::node cond) {
+  switch (tree[cond].id) {
+    case ast::COND: {
+      if (tree[cond].token != tk::AND && tree[cond].token != tk::OR) return 0;
+      int l = truth(tree.child(cond, 0));
+      int stop = tree[cond].token == tk::AND ? 0 : 1;
+      if (l == stop) return stop;
+      if (l == -1) return -1;
+      return truth(tree.child(cond, 1));
+    }
+    case ast::CMP:
+    case ast::NUM_CMP:
+    case ast::STR_CMP: {
+      val::Value l, r;
+      int op = tree[cond].token;
+      if (!literal(tree.child(cond, 0), l) || !literal(tree.child(cond, 1), r))
+        return -1;
+      if (l.is_number() && r.is_number()) return val::compare(l, r, op);
+      if (l.kind == val::STR && r.kind == val::STR && op == tk::IS)
+        return l.str() == r.str();
+      return -1;
+    }
+  }
+  return 0;
+}
+
+unsigned PassManager::unreachable(ast::node body) {
+  return blocks(statements(body));
+}
+
+// main goes on past a return, a block ends there
+unsigned PassManager::blocks(ast::node parent) {
+  unsigned changes = 0;
+  ast::Children children = tree.children(parent);
+  for (unsigned i = 0; i < children.size(); ++i) {
+    ast::node a = children[i];
+    switch (tree[a].id) {
+      case ast::IF:
+        changes += blocks(tree.child(a, 1));
+        for (unsigned j = 2; j < tree.children(a).size(); ++j) {
+          changes += blocks(tree.children(tree.child(a, j)).back());
+        }
+        break;
+      case ast::WHILE:
+      case ast::FOR:
+        changes += blocks(tree.child(a, 1));
+        break;
+      case ast::RETURN:
+        if (tree[parent].id != ast::BLOCK || i + 1 == children.size()) break;
+        tree[parent].count = i + 1;
+        return changes + children.size() - i - 1;
+    }
+  }
+  return changes;
+}
+
+unsigned PassManager::hoist(ast::node body) {
+  ast::node list = statements(body);
+  std::set<int> defined;
+  scope = &scopes[tree[body].slot];
+  for (unsigned i = 0; i < scope->params; ++i) {
+    defined.insert(i);
+  }
+  number_variables(list);
+  return loops(list, defined);
+}
+
+// The variables that are only written by counting loops and by assignments
+// of what numeric() takes for a number. Such a number is computed from
+// variables written before it, so it is enough to start from all of the
+// variables and to drop the ones assigned anything else until none is left
+// to drop. The parameters hold whatever the calls pass.
+void PassManager::number_variables(ast::node list) {
+  std::vector<ast::node> stores;
+  numbers.clear();
+  assignments(list, stores);
+  for (auto a : stores) {
+    numbers.insert(tree[tree.child(a, 0)].slot);
+  }
+  for (unsigned i = 0; i < scope->params; ++i) {
+    numbers.erase(i);
+  }
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (auto a : stores) {
+      int slot = tree[tree.child(a, 0)].slot;
+      if (tree[a].id == ast::ASSIGN && numbers.count(slot) != 0 &&
+          !numeric(tree.child(a, 1))) {
+        numbers.erase(slot);
+        changed = true;
+      }
+    }
+  }
+}
+
+// the assignments to variables and the ranges of counting loops
+void PassManager::assignments(ast::node n, std::vector<ast::node> &out) {
+  if (n == ast::NONE || tree[n].id == ast::METHOD) return;
+  if ((tree[n].id == ast::ASSIGN && tree[tree.child(n, 0)].id == ast::ID) ||
+      tree[n].id == ast::RANGE)
+    out.push_back(n);
+  for (auto a : tree.children(n)) {
+    assignments(a, out);
+  }
+}
+
+// Goes through the statements of main or of a block in order, defined holds
+// the variables that have been assigned whenever the statement at hand runs.
+// What is hoisted out of a loop goes right before it, loops are gone through
+// before the loops in them so that it goes as far out as it can.
+unsigned PassManager::loops(ast::node parent, std::set<int> defined) {
+  unsigned changes = 0;
+  std::vector<ast::node> out;
+  ast::Children children = tree.children(parent);
+  for (auto a : children) {
+    switch (tree[a].id) {
+      case ast::WHILE:
+      case ast::FOR: {
+        std::set<int> written;
+        std::size_t before = out.size();
+        mutations(a, written);
+        if (tree[a].id == ast::WHILE)
+          changes += lift(tree.child(a, 0), written, defined, out);
+        changes += lift(tree.child(a, 1), written, defined, out);
+        for (std::size_t i = before; i < out.size(); ++i) {
+          defined.insert(tree[tree.child(out[i], 0)].slot);
+        }
+        std::set<int> inner = defined;
+        if (tree[a].id == ast::FOR)
+          inner.insert(tree[tree.child(tree.child(a, 0), 0)].slot);
+        changes += loops(tree.child(a, 1), inner);
+        break;
+      }
+      case ast::IF:
+        changes += loops(tree.child(a, 1), defined);
+        for (unsigned j = 2; j < tree.children(a).size(); ++j) {
+          changes += loops(tree.children(tree.child(a, j)).back(), defined);
+        }
+        break;
+      case ast::ASSIGN:
+        if (tree[tree.child(a, 0)].id == ast::ID)
+          defined.insert(tree[tree.child(a, 0)].slot);
+        break;
+    }
+    out.push_back(a);
+  }
+  if (out.size() != children.size()) set_children(parent, out);
+  return changes;
+}
+
+// the variables a loop may change the value or the length of; an element of
+// an array can be assigned without changing its length
+void PassManager::mutations(ast::node n, std::set<int> &written) {
+  if (n == ast::NONE) return;
+  switch (tree[n].id) {
+    case ast::METHOD:
+      return;
+    case ast::ASSIGN:
+      if (tree[tree.child(n, 0)].id == ast::ID)
+        written.insert(tree[tree.child(n, 0)].slot);
+      break;
+    case ast::RANGE:
+      written.insert(tree[tree.child(n, 0)].slot);
+      break;
+    case ast::STD_VOID:
+      if (tree[n].token == tk::ID_VAR) written.insert(tree[n].slot);
+      break;
+    case ast::STD_RETURN:
+      if (tree[n].token != tk::ID_VAR) break;
+      switch (tree[tree.children(n).back()].token) {
+        case tk::LENGTH:
+        case tk::HAS_NEXT:
+        case tk::IS_EMPTY:
+          break;
+        default:
+          written.insert(tree[n].slot);
+      }
+      break;
+  }
+  for (auto a : tree.children(n)) {
+    mutations(a, written);
+  }
+}
+
+// replaces the largest invariant expressions under n by the variables that
+// the assignments put in out hold them in
+unsigned PassManager::lift(ast::node n, const std::set<int> &written,
+                           const std::set<int> &defined,
+                           std::vector<ast::node> &out) {
+  if (n == ast::NONE) return 0;
+  unsigned changes = 0;
+  switch (tree[n].id) {
+    case ast::METHOD:
+      return 0;
+    case ast::BINOP:
+    case ast::NUM_BINOP:
+    case ast::UN_MIN:
+    case ast::STD_RETURN:
+      if (invariant(n, written, defined)) {
+        out.push_back(temporary(n));
+        return 1;
+      }
+      break;
+    case ast::ASSIGN:
+      if (tree[tree.child(n, 0)].id == ast::ID)
+        return lift(tree.child(n, 1), written, defined, out);
+      break;
+    case ast::RANGE:
+      changes += lift(tree.child(n, 1), written, defined, out);
+      return changes + lift(tree.child(n, 2), written, defined, out);
+  }
+  for (auto a : tree.children(n)) {
+    changes += lift(a, written, defined, out);
+  }
+  return changes;
+}
+
+// an expression that computes the same value before the loop as in it, and
+// that cannot fail there: it only reads variables that are assigned before
+// the loop and not in it, and its arithmetic only ever gets numbers
+bool PassManager::invariant(ast::node n, const std::set<int> &written,
+                            const std::set<int> &defined) {
+  switch (tree[n].id) {
+    case ast::NUM:
+      return true;
+    case ast::ID:
+      return written.count(tree[n].slot) == 0 &&
+             defined.count(tree[n].slot) != 0;
+    case ast::STD_RETURN:
+      return tree[n].token == tk::ID_VAR && tree[n].count == 1 &&
+             tree[tree.child(n, 0)].token == tk::LENGTH &&
+             written.count(tree[n].slot) == 0 &&
+             defined.count(tree[n].slot) != 0;
+    case ast::UN_MIN:
+      return invariant(tree.child(n, 0), written, defined) &&
+             numeric(tree.child(n, 0));
+    // ty::Typer has proven the operands of NUM_BINOP to be numbers
+    case ast::BINOP:
+    case ast::NUM_BINOP:
+      if (tree[n].id == ast::BINOP &&
+          (!numeric(tree.child(n, 0)) || !numeric(tree.child(n, 1))))
+        return false;
+      return total(n) && invariant(tree.child(n, 0), written, defined) &&
+             invariant(tree.child(n, 1), written, defined);
+  }
+  return false;
+}
+
+// an expression whose value is a number whenever it is computed at all
+bool PassManager::numeric(ast::node n) {
+  switch (tree[n].id) {
+    case ast::NUM:
+    case ast::UN_MIN:
+    case ast::NUM_BINOP:
+      return true;
+    case ast::ID:
+      return numbers.count(tree[n].slot) != 0;
+    case ast::BINOP:
+      return tree[n].token != tk::PLUS ||
+             (numeric(tree.child(n, 0)) && numeric(tree.child(n, 1)));
+    case ast::STD_RETURN:
+      if (tree[n].token != tk::ID_VAR) return false;
+      switch (tree[tree.children(n).back()].token) {
+        case tk::LENGTH:
+        case tk::HAS_NEXT:
+        case tk::IS_EMPTY:
+          return true;
+      }
+  }
+  return false;
+}
+
+// an operation on numbers that cannot fail, a division only by a literal
+// that is not 0
+bool PassManager::total(ast::node n) {
+  val::Value r;
+  switch (tree[n].token) {
+    case tk::PLUS:
+    case tk::MINUS:
+    case tk::MULT:
+      return true;
+    case tk::DIV_WOQ:
+      return literal(tree.child(n, 1), r) && r.is_number() &&
+             val::to_double(r) != 0;
+    case tk::DIV_WQ:
+    case tk::MOD:
+      return literal(tree.child(n, 1), r) && r.is_number() &&
+             val::to_int(r) != 0;
+  }
+  return false;
+}
+
+void PassManager::make_variable(ast::node n, int slot, std::uint32_t name) {
+  ast::Node &x = tree[n];
+  x.id = ast::ID;
+  x.token = tk::ID_VAR;
+  x.num_type = 0;
+  x.is_terminal = true;
+  x.count = 0;
+  x.payload = name;
+  x.slot = slot;
+}
+
+// n becomes a read of a new variable, the assignment of what n computed to
+// it is returned
+ast::node PassManager::temporary(ast::node n) {
+  int slot = scope->locals.size();
+  scope->locals.push_back("%" + std::to_string(slot));
+  numbers.insert(slot);
+  std::uint32_t name = tree.strings.size();
+  tree.strings.push_back(scope->locals.back());
+  ast::node value = tree.add(tree[n].id);
+  tree[value] = tree[n];
+  ast::node target = tree.add(ast::ID);
+  tree[target].line = tree[n].line;
+  make_variable(target, slot, name);
+  make_variable(n, slot, name);
+  ast::node assign = tree.add(ast::ASSIGN);
+  ast::node children[] = {target, value};
+  tree.close(assign, children, 2);
+  return assign;
+}
+
+}  // namespace opt
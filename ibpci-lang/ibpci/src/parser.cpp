@@ -2,27 +2,77 @@
 
 namespace prs {
 
-Parser::Parser(std::string buffer) {
-  if (buffer == "") {
+Parser::Parser(std::string_view source) : lex(source) {
+  if (source.empty()) {
     std::cout << "Empty buffer passed to parser\n";
     exit(1);
   }
-  lex = lxr::Lexer(buffer);
-  if (!lex.get_next_token(token)) {
+  lex.tokenize(lexed);
+  read(lexed);
+}
+
+Parser::Parser(std::string_view source, const lxr::Tokens &tokens)
+    : lex(source) {
+  read(tokens);
+}
+
+Parser::Parser(std::istream &in, std::size_t chunk) : lex(in, chunk) {
+  if (!lex.next_span(token)) {
+    set_error(-1);
+  }
+}
+
+void Parser::read(const lxr::Tokens &buffer) {
+  tokens = &buffer;
+  token = buffer.span(0);
+  if (buffer.failed && buffer.size() == 1) {
     set_error(-1);
   }
 }
 
+// moves on to the next token, false if the lexer failed on it
+bool Parser::advance() {
+  if (tokens == nullptr) return lex.next_span(token);
+  token = tokens->span(++cursor);
+  return !tokens->failed || cursor + 1 < tokens->size();
+}
+
+// the line the lexer was at after reading the current token
+unsigned Parser::line() const {
+  if (tokens == nullptr) return lex.line_num;
+  if (tokens->failed && cursor + 1 == tokens->size())
+    return tokens->error.line_num;
+  return token.line;
+}
+
+Error Parser::lex_error() const {
+  return tokens == nullptr ? lex.get_error() : tokens->error;
+}
+
+// whether the lexer failed right after the current token
+bool Parser::lexer_failed() const {
+  if (tokens == nullptr) return lex.failed();
+  return tokens->failed && cursor + 1 == tokens->size();
+}
+
+// id of the token ahead places after the current one; past the end of the
+// tokens that is the last one, a streaming parser only sees the current one
+int Parser::peek(std::size_t ahead) const {
+  if (ahead == 0) return token.id;
+  if (tokens == nullptr) return -1;
+  return tokens->ids[std::min(cursor + ahead, tokens->size() - 1)];
+}
+
 void Parser::eat(int token_id) {
   if (error_flag) {
-    std::cout << "error set, eating token: " << error_flag << "\n";
+    DIAGNOSE(TRACE, PARSER,
+             "error set, not eating " << tk::id_to_str(token_id));
     return;
   }
   if (token.id == token_id) {
-    if (!lex.get_next_token(token)) {
-      std::cout << "Explicitly throwing error from eat() in parser.cpp\n";
-      Error err = lex.get_error();
-      std::cout << "Error message: " << err.message << std::endl;
+    if (!advance()) {
+      DIAGNOSE(DEBUG, PARSER,
+               "lexer failed at line " << lex_error().line_num);
       set_error(-1);
     }
   } else {
@@ -31,43 +81,199 @@ void Parser::eat(int token_id) {
 }
 
 void Parser::set_error(int token_id) {
-  std::cout << "setting error\n";
   error_flag = true;
-  current_error.line_num = lex.line_num;
-  current_error.message = "SYNTAX ERROR at line " +
-                          std::to_string(lex.line_num) +
-                          ":unexpected token: " + tk::id_to_str(token.id);
-  if (token_id >= 0) {
-    current_error.message += ", expected token: " + tk::id_to_str(token_id);
+  if (lexer_failed()) {
+    // the token after the current one is not a token at all, that is the
+    // error rather than what the parser expected
+    current_error = lex_error();
+  } else {
+    current_error.line_num = line();
+    current_error.type = ErrorType::PARSER;
+    current_error.message = "SYNTAX ERROR at line " + std::to_string(line()) +
+                            ":unexpected token: " + tk::id_to_str(token.id);
+    if (token_id >= 0) {
+      current_error.message += ", expected token: " + tk::id_to_str(token_id);
+    }
   }
+  if (recover) errors.push_back(current_error);
+  DIAGNOSE(DEBUG, PARSER, "setting error: " << current_error.message);
 }
 
 Error Parser::get_error() { return current_error; }
 
-void Parser::error(int token_id) {
-  std::cout << "SYNTAX ERROR at line " << lex.line_num
-            << ":unexpected token: " << tk::id_to_str(token.id);
-  if (token_id >= 0)
-    std::cout << ", expected token: " << tk::id_to_str(token_id);
-  std::cout << std::endl;
-  exit(1);
+ast::node Parser::open(int id) { return tree->add(id); }
+
+ast::node Parser::open(int id, const tk::Span &token) {
+  std::uint32_t payload = 0;
+  if (token.id == tk::NUM) {
+    payload = tree->numbers.size();
+    tree->numbers.push_back(tokens == nullptr ? lex.value(token)
+                                              : tokens->values[cursor]);
+  } else if (token.id < tk::PLUS || token.id > tk::COMMA) {
+    payload = intern(lex.lexeme(token));
+  }
+  return tree->add(id, token, payload);
+}
+
+std::uint32_t Parser::intern(std::string_view text) {
+  auto it = interned.find(text);
+  if (it == interned.end()) {
+    tree->strings.emplace_back(text);
+    it = interned.emplace(tree->strings.back(), tree->strings.size() - 1)
+             .first;
+  }
+  return it->second;
+}
+
+void Parser::close(ast::node n, std::size_t mark) {
+  tree->close(n, scratch.data() + mark, scratch.size() - mark);
+  scratch.resize(mark);
+}
+
+// Parsing on threads goes in two steps. The program is first parsed without
+// the bodies of its methods, then the bodies are parsed on threads, runs of
+// them in source order by a parser of their own into a tree of their own,
+// and merged into the tree in source order. Any error anywhere has the whole
+// program parsed again in one go, the error reported is then the first one
+// in the source whichever thread came across what.
+ast::Tree *Parser::parse(unsigned threads) {
+#ifndef __EMSCRIPTEN__
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  // parser diagnostics come in source order
+  if (threads > 1 && !lazy && !recover && tokens != nullptr &&
+      lex.get_source().size() >= lxr::PARALLEL_MIN &&
+      !dg::enabled(dg::INFO, dg::PARSER)) {
+    lazy = true;
+    ast::Tree *out = parse_tree();
+    lazy = false;
+    if (out != nullptr && parse_bodies(threads)) return out;
+    delete out;
+    error_flag = false;
+    interned.clear();
+    bodies.clear();
+    cursor = 0;
+    read(*tokens);
+  }
+#endif
+  return parse_tree();
 }
 
-ast::AST *Parser::parse() {
-  ast::AST *root = new ast::AST(ast::START);
+ast::Tree *Parser::parse_tree() {
+  tree = new ast::Tree;
+  std::size_t mark = scratch.size();
+  tree->root = open(ast::START);
   while (token.id != tk::END_FILE && !error_flag) {
-    root->push_child(stmt());
+    scratch.push_back(statement());
   }
-  if (error_flag) {
-    ast::delete_tree(root);
+  if (error_flag && !recover) {
+    scratch.clear();
+    delete tree;
     return nullptr;
   }
+  close(tree->root, mark);
+  return tree;
+}
+
+ast::Tree *Parser::start() {
+  tree = new ast::Tree;
+  tree->root = open(ast::START);
+  return tree;
+}
+
+ast::node Parser::next_stmt() {
+  nodes_mark = tree->nodes.size();
+  kids_mark = tree->kids.size();
+  numbers_mark = tree->numbers.size();
+  strings_mark = tree->strings.size();
+  if (token.id == tk::END_FILE || error_flag) return ast::NONE;
+  ast::node root = stmt();
+  return error_flag ? ast::NONE : root;
+}
+
+// the statement is the last thing in every buffer of the tree
+void Parser::forget_stmt() {
+  for (std::size_t i = strings_mark; i < tree->strings.size(); ++i) {
+    interned.erase(tree->strings[i]);
+  }
+  tree->nodes.resize(nodes_mark);
+  tree->kids.resize(kids_mark);
+  tree->numbers.resize(numbers_mark);
+  tree->strings.resize(strings_mark);
+}
+
+// nothing more to parse, the lexer may have failed on the last token
+bool Parser::at_end() const {
+  return token.id == tk::END_FILE ||
+         (tokens != nullptr && tokens->failed && cursor + 1 == tokens->size());
+}
+
+// recovering: moves on to the token after the statement starting at first.
+// An if, a loop or a method ends with the 'end' that closes it, the ones
+// nested in it counted; an 'end' of another kind closes what it is in, so it
+// is where the statement ends. Any other statement ends before the next token
+// that starts a line and can start a statement or end a block.
+void Parser::synchronize(std::size_t first) {
+  const std::vector<std::uint8_t> &ids = tokens->ids;
+  const std::vector<std::uint32_t> &lines = tokens->lines;
+  std::size_t last = tokens->size() - 1;
+  std::size_t i = std::max(cursor, first + 1);
+  auto opens = [&](std::size_t at) {
+    return (ids[at] == tk::IF || ids[at] == tk::LOOP ||
+            ids[at] == tk::METHOD) &&
+           (at == 0 || (ids[at - 1] != tk::END && ids[at - 1] != tk::ELSE));
+  };
+  if (opens(first)) {
+    std::vector<std::uint8_t> kinds;
+    for (i = first; i < last; ++i) {
+      if (opens(i)) {
+        kinds.push_back(ids[i]);
+      } else if (ids[i] == tk::END &&
+                 (ids[i + 1] == tk::IF || ids[i + 1] == tk::LOOP ||
+                  ids[i + 1] == tk::METHOD)) {
+        if (kinds.size() == 1 && kinds.back() != ids[i + 1]) break;
+        kinds.pop_back();
+        if (kinds.empty()) {
+          i += 2;
+          break;
+        }
+        ++i;
+      }
+    }
+  } else {
+    for (; i < last; ++i) {
+      if (lines[i] == lines[i - 1]) continue;
+      std::uint8_t id = ids[i];
+      if (id == tk::ID_VAR || id == tk::ID_METHOD || id == tk::METHOD ||
+          id == tk::IF || id == tk::RETURN || id == tk::LOOP ||
+          id == tk::INPUT || id == tk::OUTPUT || id == tk::END ||
+          id == tk::ELSE)
+        break;
+    }
+  }
+  cursor = std::min(i, last);
+  token = tokens->span(cursor);
+  if (tokens->failed && cursor == last) set_error(-1);
+}
+
+// recovering: a statement with an error in it is skipped, as an ERROR node
+ast::node Parser::statement() {
+  if (!recover || tokens == nullptr) return stmt();
+  std::size_t mark = scratch.size();
+  std::size_t first = cursor;
+  unsigned first_line = token.line;
+  ast::node root = stmt();
+  if (!error_flag || at_end()) return root;
+  scratch.resize(mark);
+  error_flag = false;
+  synchronize(first);
+  root = open(ast::ERROR);
+  (*tree)[root].line = first_line;
   return root;
 }
 
-ast::AST *Parser::stmt() {
+ast::node Parser::stmt() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
   switch (token.id) {
     case tk::ID_VAR:
@@ -86,295 +292,468 @@ ast::AST *Parser::stmt() {
         return loop_whl();
       else if (token.id == tk::ID_VAR || token.id == tk::ID_METHOD)
         return loop_for();
+      DIAGNOSE(DEBUG, PARSER,
+               "no loop starts with " << tk::id_to_str(token.id));
+      set_error(-1);
+      break;
     case tk::INPUT:
       return in_out();
     case tk::OUTPUT:
       return in_out();
     default:
-      std::cout << "defautl stmt()\n";
+      DIAGNOSE(DEBUG, PARSER,
+               "no statement starts with " << tk::id_to_str(token.id));
       set_error(-1);
   }
-  return nullptr;
+  return ast::NONE;
 }
 
-ast::AST *Parser::block() {
+ast::node Parser::block() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(ast::BLOCK);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::BLOCK);
   while (token.id != tk::END && !error_flag) {
-    root->push_child(stmt());
+    scratch.push_back(statement());
   }
   eat(tk::END);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::if_block() {
+ast::node Parser::if_block() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(ast::BLOCK);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::BLOCK);
   while (token.id != tk::END && !error_flag) {
     if (token.id == tk::ELSE) {
-      return root;
+      break;
     } else {
-      root->push_child(stmt());
+      scratch.push_back(statement());
     }
   }
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::method() {
+ast::node Parser::method() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
   eat(tk::METHOD);
-  ast::AST *params = nullptr;
-  ast::AST *root = new ast::AST(token, ast::METHOD);
+  std::size_t mark = scratch.size();
+  ast::node params = ast::NONE;
+  ast::node root = open(ast::METHOD, token);
   eat(tk::ID_METHOD);
   eat(tk::LPAREN);
   if (token.id == tk::ID_VAR) {
-    params = new ast::AST(ast::PARAM);
-    params->push_child(factor());
+    std::size_t params_mark = scratch.size();
+    params = open(ast::PARAM);
+    scratch.push_back(factor());
     while (token.id != tk::RPAREN && !error_flag) {
       eat(tk::COMMA);
-      params->push_child(factor());
+      scratch.push_back(factor());
     }
+    close(params, params_mark);
   }
   eat(tk::RPAREN);
-  if (params != nullptr) root->push_child(params);
-  root->push_child(block());
+  if (params != ast::NONE) scratch.push_back(params);
+  if (!lazy || !skip_body(root)) scratch.push_back(block());
   eat(tk::METHOD);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::ret() {
+// moves on to the 'end' of the 'end method' that closes the body starting at
+// the current token, methods declared inside of it included; a body that is
+// not closed is left to be parsed for its error
+bool Parser::skip_body(ast::node method) {
+  if (error_flag || tokens == nullptr) return false;
+  std::size_t size = tokens->size() - (tokens->failed ? 1 : 0);
+  unsigned depth = 0;
+  for (std::size_t i = cursor; i + 1 < size; ++i) {
+    if (tokens->ids[i] == tk::METHOD) {
+      ++depth;
+    } else if (tokens->ids[i] == tk::END &&
+               tokens->ids[i + 1] == tk::METHOD) {
+      if (depth == 0) {
+        bodies[method] = {cursor, i};
+        cursor = i;
+        token = tokens->span(cursor);
+        eat(tk::END);
+        return true;
+      }
+      --depth;
+      ++i;
+    }
+  }
+  return false;
+}
+
+bool Parser::parse_body(ast::node method) {
+  auto it = bodies.find(method);
+  cursor = it->second.first;
+  bodies.erase(it);
+  token = tokens->span(cursor);
+  std::size_t mark = scratch.size();
+  for (auto a : tree->children(method)) scratch.push_back(a);
+  scratch.push_back(block());
+  eat(tk::METHOD);
+  close(method, mark);
+  return !error_flag;
+}
+
+// the bodies skipped by parse(), false if any of them has an error
+bool Parser::parse_bodies(unsigned threads) {
+#ifndef __EMSCRIPTEN__
+  std::vector<std::pair<ast::node, Body>> order(bodies.begin(), bodies.end());
+  bodies.clear();
+  std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+    return a.second.first < b.second.first;
+  });
+  // runs of bodies of about the same number of tokens, a few per thread
+  std::vector<std::size_t> runs{0};
+  std::size_t total = 0, count = 0;
+  for (auto &a : order) total += a.second.last - a.second.first;
+  std::size_t share = total / (threads * 4) + 1;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    count += order[i].second.last - order[i].second.first;
+    if (count >= share || i + 1 == order.size()) {
+      runs.push_back(i + 1);
+      count = 0;
+    }
+  }
+
+  std::vector<ast::Tree> arenas(runs.size() - 1);
+  std::vector<std::vector<ast::node>> roots(arenas.size());
+  std::atomic<bool> failed{false};
+  std::atomic<std::size_t> next{0};
+  std::string_view source = lex.get_source();
+  auto work = [&]() {
+    for (std::size_t run; (run = next++) < arenas.size() && !failed;) {
+      Parser parser(source, *tokens);
+      parser.tree = &arenas[run];
+      for (std::size_t i = runs[run]; i < runs[run + 1]; ++i) {
+        const Body &body = order[i].second;
+        parser.cursor = body.first;
+        parser.token = tokens->span(body.first);
+        roots[run].push_back(parser.block());
+        // the body has to end where the scan said it does
+        if (parser.cursor != body.last + 1) parser.set_error(-1);
+        parser.eat(tk::METHOD);
+        if (parser.error_flag) {
+          failed = true;
+          break;
+        }
+      }
+      parser.tree = nullptr;
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned i = 1; i < threads; ++i) pool.emplace_back(work);
+  work();
+  for (auto &thread : pool) thread.join();
+  if (failed) return false;
+
+  std::vector<ast::node> methods;
+  for (std::size_t run = 0; run < arenas.size(); ++run) {
+    methods.clear();
+    for (std::size_t i = runs[run]; i < runs[run + 1]; ++i)
+      methods.push_back(order[i].first);
+    merge(arenas[run], roots[run], methods);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// moves the nodes of a tree parsed on its own into the tree and hangs the
+// body roots under their methods
+void Parser::merge(const ast::Tree &arena, const std::vector<ast::node> &roots,
+                   const std::vector<ast::node> &methods) {
+  ast::node nodes = tree->nodes.size();
+  std::uint32_t kids = tree->kids.size();
+  std::uint32_t numbers = tree->numbers.size();
+  std::vector<std::uint32_t> strings;
+  for (auto &a : arena.strings) strings.push_back(intern(a));
+  for (ast::Node x : arena.nodes) {
+    x.first += kids;
+    if (x.is_terminal && x.token == tk::NUM)
+      x.payload += numbers;
+    else if (x.is_terminal && (x.token < tk::PLUS || x.token > tk::COMMA))
+      x.payload = strings[x.payload];
+    tree->nodes.push_back(x);
+  }
+  for (auto a : arena.kids)
+    tree->kids.push_back(a == ast::NONE ? a : a + nodes);
+  tree->numbers.insert(tree->numbers.end(), arena.numbers.begin(),
+                       arena.numbers.end());
+  for (std::size_t i = 0; i < methods.size(); ++i) {
+    std::size_t mark = scratch.size();
+    for (auto a : tree->children(methods[i])) scratch.push_back(a);
+    scratch.push_back(roots[i] == ast::NONE ? roots[i] : roots[i] + nodes);
+    close(methods[i], mark);
+  }
+}
+
+ast::node Parser::ret() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(token, ast::RETURN);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::RETURN, token);
   eat(tk::RETURN);
-  root->push_child(expr());
+  scratch.push_back(expr());
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::loop_whl() {
+ast::node Parser::loop_whl() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(ast::WHILE);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::WHILE);
   eat(tk::WHILE);
-  root->push_child(cond());
-  root->push_child(block());
+  scratch.push_back(cond());
+  scratch.push_back(block());
   eat(tk::LOOP);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::loop_for() {
+ast::node Parser::loop_for() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(ast::FOR);
-  ast::AST *loop_range = new ast::AST(ast::RANGE);
-  loop_range->push_child(factor());
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::FOR);
+  std::size_t range_mark = scratch.size();
+  ast::node loop_range = open(ast::RANGE);
+  scratch.push_back(factor());
   eat(tk::FROM);
-  loop_range->push_child(expr());
+  scratch.push_back(expr());
   eat(tk::TO);
-  loop_range->push_child(expr());
-  root->push_child(loop_range);
-  root->push_child(block());
+  scratch.push_back(expr());
+  close(loop_range, range_mark);
+  scratch.push_back(loop_range);
+  scratch.push_back(block());
   eat(tk::LOOP);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::if_stmt() {
+ast::node Parser::if_stmt() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(token, ast::IF);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::IF, token);
   eat(tk::IF);
-  root->push_child(cond());
+  scratch.push_back(cond());
   eat(tk::THEN);
-  root->push_child(if_block());
+  scratch.push_back(if_block());
   while (token.id == tk::ELSE && !error_flag) {
-    root->push_child(else_stmt());
+    scratch.push_back(else_stmt());
   }
   eat(tk::END);
   eat(tk::IF);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::else_stmt() {
+ast::node Parser::else_stmt() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root;
   eat(tk::ELSE);
-  if (token.id == tk::IF) {
-    root = elif_stmt();
-    return root;
-  } else {
-    root = new ast::AST(ast::ELSE);
-    root->push_child(if_block());
-  }
+  if (token.id == tk::IF) return elif_stmt();
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::ELSE);
+  scratch.push_back(if_block());
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::elif_stmt() {
+ast::node Parser::elif_stmt() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
   eat(tk::IF);
-  ast::AST *root = new ast::AST(ast::ELIF);
-  root->push_child(cond());
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::ELIF);
+  scratch.push_back(cond());
   eat(tk::THEN);
-  root->push_child(if_block());
+  scratch.push_back(if_block());
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::cond() {
+ast::node Parser::cond() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root, *new_node;
+  ast::node root, new_node;
+  std::size_t mark = scratch.size();
   root = cmp();
   while ((token.id == tk::AND || token.id == tk::OR) && !error_flag) {
-    new_node = new ast::AST(token, ast::COND);
-    new_node->push_child(root);
+    new_node = open(ast::COND, token);
+    scratch.push_back(root);
     root = new_node;
     eat(token.id);
-    new_node->push_child(cmp());
+    scratch.push_back(cmp());
+    close(new_node, mark);
   }
   return root;
 }
 
-ast::AST *Parser::cmp() {
+ast::node Parser::cmp() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root, *new_node;
+  ast::node root, new_node;
+  std::size_t mark = scratch.size();
   root = factor();
   if (token.id == tk::IS || token.id == tk::LT || token.id == tk::GT ||
       token.id == tk::DNEQ || token.id == tk::GEQ || token.id == tk::LEQ) {
-    new_node = new ast::AST(token, ast::CMP);
-    new_node->push_child(root);
+    new_node = open(ast::CMP, token);
+    scratch.push_back(root);
     root = new_node;
     eat(token.id);
-    new_node->push_child(expr());
+    scratch.push_back(expr());
+    close(new_node, mark);
   }
   return root;
 }
 
-ast::AST *Parser::assign() {
+ast::node Parser::assign() {
   if (error_flag) {
-    return nullptr;
-  }
-  ast::AST *root = new ast::AST(ast::ASSIGN);
-  root->push_child(factor());
-  if (root->children[0]->id == ast::STD_VOID) {
-    root->id = ast::STD_VOID;
-    return root;
+    return ast::NONE;
+  }
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::ASSIGN);
+  ast::node target = factor();
+  scratch.push_back(target);
+  if (target != ast::NONE && (*tree)[target].id == ast::STD_VOID) {
+    (*tree)[root].id = ast::STD_VOID;
   } else {
     eat(tk::EQ);
-    root->push_child(expr());
+    scratch.push_back(expr());
   }
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::method_call() {
+ast::node Parser::method_call() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(token, ast::METHOD_CALL);
-  ast::AST *params = nullptr;
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::METHOD_CALL, token);
+  ast::node params = ast::NONE;
   eat(tk::ID_METHOD);
   eat(tk::LPAREN);
   if (token.id != tk::RPAREN) {
-    params = new ast::AST(ast::PARAM);
-    params->push_child(expr());
+    std::size_t params_mark = scratch.size();
+    params = open(ast::PARAM);
+    scratch.push_back(expr());
     while (token.id != tk::RPAREN && !error_flag) {
       eat(tk::COMMA);
-      params->push_child(expr());
+      scratch.push_back(expr());
     }
+    close(params, params_mark);
   }
   eat(tk::RPAREN);
-  if (params != nullptr) root->push_child(params);
+  if (params != ast::NONE) scratch.push_back(params);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::expr() {
+ast::node Parser::expr() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root, *new_node;
+  ast::node root, new_node;
+  std::size_t mark = scratch.size();
   root = term();
-  while (token.id == tk::PLUS || token.id == tk::MINUS) {
-    new_node = new ast::AST(token, ast::BINOP);
-    new_node->push_child(root);
+  while ((token.id == tk::PLUS || token.id == tk::MINUS) && !error_flag) {
+    new_node = open(ast::BINOP, token);
+    scratch.push_back(root);
     root = new_node;
     eat(token.id);
-    new_node->push_child(term());
+    scratch.push_back(term());
+    close(new_node, mark);
   }
   return root;
 }
 
-ast::AST *Parser::term() {
+ast::node Parser::term() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *subroot, *new_node;
+  ast::node subroot, new_node;
+  std::size_t mark = scratch.size();
   subroot = factor();
-  while (token.id == tk::MULT || token.id == tk::DIV_WQ ||
-         token.id == tk::DIV_WOQ || token.id == tk::MOD) {
-    new_node = new ast::AST(token, ast::BINOP);
-    new_node->push_child(subroot);
+  while ((token.id == tk::MULT || token.id == tk::DIV_WQ ||
+          token.id == tk::DIV_WOQ || token.id == tk::MOD) &&
+         !error_flag) {
+    new_node = open(ast::BINOP, token);
+    scratch.push_back(subroot);
     subroot = new_node;
     eat(token.id);
-    new_node->push_child(factor());
+    scratch.push_back(factor());
+    close(new_node, mark);
   }
   return subroot;
 }
 
-ast::AST *Parser::factor() {
+ast::node Parser::factor() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *new_node;
+  ast::node new_node;
+  std::size_t mark = scratch.size();
   switch (token.id) {
     case tk::NUM:
-      new_node = new ast::AST(token, ast::NUM);
+      new_node = open(ast::NUM, token);
       eat(tk::NUM);
       return new_node;
     case tk::MINUS:
-      new_node = new ast::AST(token, ast::UN_MIN);
+      new_node = open(ast::UN_MIN, token);
       eat(tk::MINUS);
       if (token.id == tk::LPAREN) {
         eat(tk::LPAREN);
-        new_node->push_child(expr());
+        scratch.push_back(expr());
         eat(tk::RPAREN);
       } else
-        new_node->push_child(factor());
+        scratch.push_back(factor());
+      close(new_node, mark);
       return new_node;
     case tk::STRING:
-      new_node = new ast::AST(token, ast::STRING);
+      new_node = open(ast::STRING, token);
       eat(tk::STRING);
       return new_node;
     case tk::ID_VAR:
-      new_node = new ast::AST(token, ast::ID);
+      new_node = open(ast::ID, token);
       eat(tk::ID_VAR);
       if (token.id == tk::LSQBR) {
         while (token.id == tk::LSQBR && !error_flag) {
           eat(tk::LSQBR);
-          new_node->push_child(expr());
+          scratch.push_back(expr());
           eat(tk::RSQBR);
         }
-        if (!new_node->children.empty()) new_node->id = ast::ARR_ACC;
+        if (scratch.size() > mark) (*tree)[new_node].id = ast::ARR_ACC;
       }
       if (token.id == tk::DOT) {
-        new_node->push_child(std_method());
-        new_node->id = new_node->children[0]->id;
-        return new_node;
+        scratch.push_back(std_method());
+        if (scratch[mark] != ast::NONE)
+          (*tree)[new_node].id = (*tree)[scratch[mark]].id;
       }
+      close(new_node, mark);
       return new_node;
     case tk::ID_METHOD:
       return method_call();
@@ -391,105 +770,115 @@ ast::AST *Parser::factor() {
       eat(tk::NEW_STACK);
       eat(tk::LPAREN);
       eat(tk::RPAREN);
-      new_node = new ast::AST(token, ast::STACK);
-      return new_node;
+      return open(ast::STACK, token);
     case tk::NEW_QUEUE:
       eat(tk::NEW_QUEUE);
       eat(tk::LPAREN);
       eat(tk::RPAREN);
-      new_node = new ast::AST(token, ast::QUEUE);
-      return new_node;
+      return open(ast::QUEUE, token);
     case tk::INPUT:
       return in_out();
     case tk::OUTPUT:
       return in_out();
     case tk::END_FILE:
-      std::cout << "END";
+      DIAGNOSE(DEBUG, PARSER, "expression cut off by the end of the file");
+      [[fallthrough]];
     default:
       set_error(-1);
   }
-  return 0;
+  return ast::NONE;
 }
 
-ast::AST *Parser::arr() {
+ast::node Parser::arr() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root = new ast::AST(token, ast::ARR);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::ARR, token);
   eat(tk::LSQBR);
   if (token.id == tk::NUM || token.id == tk::STRING || token.id == tk::LSQBR) {
-    root->push_child(factor());
+    scratch.push_back(factor());
     while (token.id != tk::RSQBR && !error_flag) {
       eat(tk::COMMA);
-      root->push_child(factor());
+      scratch.push_back(factor());
     }
   }
   eat(tk::RSQBR);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::arr_dyn() {
+ast::node Parser::arr_dyn() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
   eat(tk::NEW_ARR);
-  ast::AST *root = new ast::AST(token, ast::ARR_DYN);
+  std::size_t mark = scratch.size();
+  ast::node root = open(ast::ARR_DYN, token);
   eat(tk::LPAREN);
-  root->push_child(expr());
+  scratch.push_back(expr());
   while (token.id != tk::RPAREN && !error_flag) {
     eat(tk::COMMA);
-    root->push_child(expr());
+    scratch.push_back(expr());
   }
   eat(tk::RPAREN);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::std_method() {
+ast::node Parser::std_method() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
   eat(tk::DOT);
-  ast::AST *root;
+  std::size_t mark = scratch.size();
+  ast::node root;
   if (token.id == tk::LENGTH || token.id == tk::GET_NEXT ||
       token.id == tk::HAS_NEXT || token.id == tk::POP ||
       token.id == tk::DEQUEUE || token.id == tk::IS_EMPTY ||
       token.id == tk::INPUT) {
-    root = new ast::AST(token, ast::STD_RETURN);
+    root = open(ast::STD_RETURN, token);
     eat(token.id);
   } else if (token.id == tk::GET_NEXT || token.id == tk::PUSH ||
              token.id == tk::ENQUEUE) {
-    root = new ast::AST(token, ast::STD_VOID);
+    root = open(ast::STD_VOID, token);
     eat(token.id);
+  } else {
+    set_error(-1);
+    return ast::NONE;
   }
   eat(tk::LPAREN);
   if (token.id != tk::RPAREN) {
-    root->push_child(expr());
+    scratch.push_back(expr());
     while (token.id != tk::RPAREN && !error_flag) {
       eat(tk::COMMA);
-      root->push_child(expr());
+      scratch.push_back(expr());
     }
   }
   eat(tk::RPAREN);
+  close(root, mark);
   return root;
 }
 
-ast::AST *Parser::in_out() {
+ast::node Parser::in_out() {
   if (error_flag) {
-    return nullptr;
+    return ast::NONE;
   }
-  ast::AST *root;
+  std::size_t mark = scratch.size();
+  ast::node root;
   if (token.id == tk::INPUT)
-    root = new ast::AST(token, ast::INPUT);
-  else if (token.id == tk::OUTPUT)
-    root = new ast::AST(token, ast::OUTPUT);
+    root = open(ast::INPUT, token);
+  else
+    root = open(ast::OUTPUT, token);
   eat(token.id);
   eat(tk::LPAREN);
-  root->push_child(expr());
+  scratch.push_back(expr());
   while (token.id != tk::RPAREN && !error_flag) {
     eat(tk::COMMA);
-    root->push_child(expr());
+    scratch.push_back(expr());
   }
   eat(tk::RPAREN);
+  close(root, mark);
   return root;
 }
 
@@ -0,0 +1,240 @@
+#include "../include/resolver.hpp"
+
+namespace rsv {
+
+Resolver::Resolver(ast::Tree &tree) : tree(tree) {}
+
+scopes &Resolver::get_scopes() { return resolved; }
+
+Error Resolver::get_error() { return current_error; }
+
+Scope &Resolver::scope() { return resolved[current]; }
+
+void Resolver::open_scope(std::string name) {
+  current = resolved.size();
+  resolved.emplace_back();
+  scope().name = name;
+  slots.clear();
+  bound.clear();
+  first_read.clear();
+}
+
+// a variable that is read but never assigned in its scope can only ever be
+// an undefined reference, the earliest one in the source is reported
+void Resolver::close_scope() {
+  for (unsigned i = 0; i < bound.size(); ++i) {
+    unsigned line = tree[first_read[i]].line;
+    if (bound[i] || (error_flag && current_error.line_num <= line)) continue;
+    error_flag = true;
+    current_error.message = "SEMANTIC ERROR at line " + std::to_string(line) +
+                            ": undefined reference to variable " +
+                            scope().locals[i];
+    current_error.line_num = line;
+    current_error.type = ErrorType::SEMANTIC;
+  }
+}
+
+unsigned Resolver::slot(ast::node leaf) {
+  auto it = slots.find(tree.str(leaf));
+  if (it == slots.end()) {
+    it = slots.emplace(tree.str(leaf), scope().locals.size()).first;
+    scope().locals.push_back(tree.str(leaf));
+    bound.push_back(false);
+    first_read.push_back(leaf);
+  }
+  return tree[leaf].slot = it->second;
+}
+
+void Resolver::bind(ast::node leaf) { bound[slot(leaf)] = true; }
+
+bool Resolver::resolve() {
+  std::vector<ast::node> methods;
+  open_scope("main");
+  tree[tree.root].slot = current;
+  for (auto a : tree.children(tree.root)) {
+    switch (tree[a].id) {
+      case ast::METHOD:
+        methods.push_back(a);
+        break;
+      case ast::ASSIGN:
+      case ast::STD_VOID:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::FOR:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        stmt(a);
+        break;
+    }
+  }
+  close_scope();
+  for (auto a : methods) {
+    method(a);
+  }
+  return !error_flag;
+}
+
+void Resolver::start() {
+  open_scope("main");
+  tree[tree.root].slot = current;
+}
+
+// main stays open around the scope of a method
+bool Resolver::resolve(ast::node root) {
+  switch (tree[root].id) {
+    case ast::METHOD: {
+      unsigned main = current;
+      auto main_slots = std::move(slots);
+      auto main_bound = std::move(bound);
+      auto main_reads = std::move(first_read);
+      method(root);
+      current = main;
+      slots = std::move(main_slots);
+      bound = std::move(main_bound);
+      first_read = std::move(main_reads);
+      break;
+    }
+    case ast::ASSIGN:
+    case ast::STD_VOID:
+    case ast::IF:
+    case ast::WHILE:
+    case ast::FOR:
+    case ast::METHOD_CALL:
+    case ast::OUTPUT:
+      stmt(root);
+      break;
+  }
+  return !error_flag;
+}
+
+// every parameter gets its own slot even if the names repeat, the last one
+// is the one visible in the body; a method whose body was not parsed yet is
+// resolved once it is
+void Resolver::method(ast::node root) {
+  ast::Children children = tree.children(root);
+  if (children.empty() || tree[children.back()].id != ast::BLOCK) return;
+  ast::node params = tree.child(root, 0);
+  open_scope(tree.str(root));
+  tree[root].slot = current;
+  if (tree[params].id == ast::PARAM) {
+    for (auto a : tree.children(params)) {
+      slots[tree.str(a)] = tree[a].slot = scope().locals.size();
+      scope().locals.push_back(tree.str(a));
+      bound.push_back(true);
+      first_read.push_back(a);
+    }
+    scope().params = scope().locals.size();
+  }
+  block(tree.children(root).back());
+  close_scope();
+}
+
+void Resolver::stmt(ast::node root) {
+  ast::node target, n;
+  switch (tree[root].id) {
+    case ast::ASSIGN:
+      expr(tree.child(root, 1));
+      target = tree.child(root, 0);
+      if (tree[target].id == ast::ARR_ACC)
+        expr(target);
+      else
+        bind(target);
+      break;
+    case ast::STD_VOID:
+      target = tree.child(root, 0);
+      slot(target);
+      n = tree.children(target).back();
+      if (!tree.children(n).empty()) expr(tree.child(n, 0));
+      break;
+    case ast::IF:
+      condition(tree.child(root, 0));
+      block(tree.child(root, 1));
+      for (unsigned i = 2; i < tree.children(root).size(); ++i) {
+        n = tree.child(root, i);
+        if (tree[n].id == ast::ELIF) {
+          condition(tree.child(n, 0));
+          block(tree.child(n, 1));
+        } else {
+          block(tree.child(n, 0));
+        }
+      }
+      break;
+    case ast::WHILE:
+      condition(tree.child(root, 0));
+      block(tree.child(root, 1));
+      break;
+    case ast::FOR:
+      n = tree.child(root, 0);
+      expr(tree.child(n, 1));
+      expr(tree.child(n, 2));
+      bind(tree.child(n, 0));
+      block(tree.child(root, 1));
+      break;
+    default:
+      expr(root);
+  }
+}
+
+// a return ends the block, statements the interpreter rejects are skipped
+void Resolver::block(ast::node root) {
+  for (auto a : tree.children(root)) {
+    switch (tree[a].id) {
+      case ast::ASSIGN:
+      case ast::STD_VOID:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::FOR:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        stmt(a);
+        break;
+      case ast::RETURN:
+        expr(tree.child(a, 0));
+        return;
+    }
+  }
+}
+
+void Resolver::condition(ast::node root) {
+  if (tree[root].id == ast::COND &&
+      (tree[root].token == tk::AND || tree[root].token == tk::OR)) {
+    condition(tree.child(root, 0));
+    condition(tree.child(root, 1));
+  } else if (tree[root].id == ast::CMP) {
+    expr(tree.child(root, 0));
+    expr(tree.child(root, 1));
+  }
+}
+
+void Resolver::expr(ast::node root) {
+  if (root == ast::NONE) return;
+  switch (tree[root].id) {
+    case ast::ID:
+      slot(root);
+      break;
+    case ast::STD_RETURN:
+      slot(root);
+      break;
+    case ast::ARR_ACC:
+      slot(root);
+      for (auto a : tree.children(root)) {
+        expr(a);
+      }
+      break;
+    case ast::METHOD_CALL:
+      if (!tree.children(root).empty() &&
+          tree[tree.child(root, 0)].id == ast::PARAM)
+        for (auto a : tree.children(tree.child(root, 0))) {
+          expr(a);
+        }
+      break;
+    case ast::INPUT:
+      break;
+    default:
+      for (auto a : tree.children(root)) {
+        expr(a);
+      }
+  }
+}
+
+}  // namespace rsv
@@ -2,101 +2,130 @@
 
 namespace IBPCI {
 
-Interpreter::Interpreter(ast::AST *tree, bool log) {
-  this->tree = tree;
+Interpreter::Interpreter(ast::Tree &tree, rsv::scopes &scopes, bool log)
+    : tree(tree), scopes(scopes) {
   log_stack = log;
-  call_stack = cstk::CallStack(tree, log);
+  call_stack = cstk::CallStack(tree.root, &scopes[tree[tree.root].slot], log);
 }
 
 void Interpreter::interpret() {
-  rf::Reference *method;
-  for (auto *a : tree->children) {
-    switch (a->id) {
-      case ast::ASSIGN:
-        assign(a);
-        break;
-      case ast::STD_VOID:
-        std_void(a);
-        break;
-      case ast::IF:
-        exec_if(a);
-        break;
-      case ast::WHILE:
-        exec_whl(a);
-        break;
-      case ast::FOR:
-        exec_for(a);
-        break;
-      case ast::METHOD:
-        method_decl(a);
-        break;
-      case ast::METHOD_CALL:
-        method = method_call(a);
-        delete method;
-        break;
-      case ast::OUTPUT:
-        output(a);
-        break;
-    }
+  for (auto a : tree.children(tree.root)) {
+    exec_stmt(a);
   }
-  ast::delete_tree(tree);
 }
 
-void Interpreter::error(std::string message, ast::AST *leaf) {
-  std::cout << "SEMANTIC ERROR at line " << leaf->token.line << ": " << message
+// streaming: runs one statement of main, main may have gained variables
+// since the last one
+void Interpreter::interpret(ast::node root) {
+  call_stack.grow();
+  exec_stmt(root);
+}
+
+void Interpreter::exec_stmt(ast::node root) {
+  switch (tree[root].id) {
+    case ast::ASSIGN:
+      assign(root);
+      break;
+    case ast::STD_VOID:
+      std_void(root);
+      break;
+    case ast::IF:
+      exec_if(root);
+      break;
+    case ast::WHILE:
+      exec_whl(root);
+      break;
+    case ast::FOR:
+      exec_for(root);
+      break;
+    case ast::METHOD:
+      method_decl(root);
+      break;
+    case ast::METHOD_CALL:
+      method_call(root);
+      break;
+    case ast::OUTPUT:
+      output(root);
+      break;
+  }
+}
+
+void Interpreter::error(std::string message, ast::node leaf) {
+  std::cout << "SEMANTIC ERROR at line " << tree[leaf].line << ": " << message
             << std::endl;
   exit(1);
 }
 
-void Interpreter::error(std::string message, rf::Reference *token) {
-  std::cout << "RUN-TIME error at line " << token->get_token()->line << ": "
-            << message << std::endl;
-  delete token;
+void Interpreter::error_rt(std::string message, ast::node leaf) {
+  std::cout << "RUN-TIME error at line " << tree[leaf].line << ": " << message
+            << std::endl;
   exit(1);
 }
 
-void Interpreter::method_decl(ast::AST *root) {
-  if (methods.find(root->token.val_str) == methods.end()) {
-    methods.insert(std::make_pair(root->token.val_str, root));
+void Interpreter::parse_lazily(prs::Parser &parser, rsv::Resolver &resolver,
+                               ty::Typer &typer) {
+  this->parser = &parser;
+  this->resolver = &resolver;
+  this->typer = &typer;
+}
+
+// errors in the body are reported the way errors found before the program
+// ran are
+void Interpreter::load_body(ast::node method) {
+  if (!parser->parse_body(method)) {
+    std::cout << parser->get_error().message;
+    exit(1);
+  }
+  if (!resolver->resolve(method)) {
+    std::cout << resolver->get_error().message << std::endl;
+    exit(1);
+  }
+  typer->specialize(method);
+}
+
+void Interpreter::method_decl(ast::node root) {
+  if (methods.find(tree.str(root)) == methods.end()) {
+    methods.insert(std::make_pair(tree.str(root), root));
   } else {
     error("Duplicate method declaration", root);
   }
 }
 
-rf::Reference *Interpreter::method_call(ast::AST *root) {
-  std::string method_name = root->token.val_str;
-  std::vector<rf::Reference *> computed_params;
-  rf::Reference *return_reference;
-  if (!root->children.empty())
-    collect_params(root->children[0], &computed_params);
-  call_stack.push_AR(method_name, lookup_method(method_name, root));
-  ast::AST *method_root = call_stack.peek_for_root();
+val::Value Interpreter::method_call(ast::node root) {
+  std::string method_name = tree.str(root);
+  std::vector<val::Value> computed_params;
+  val::Value return_value;
+  if (!tree.children(root).empty())
+    collect_params(tree.child(root, 0), &computed_params);
+  ast::node method_root = lookup_method(method_name, root);
+  if (parser != nullptr && parser->deferred(method_root))
+    load_body(method_root);
+  DIAGNOSE(DEBUG, RUNTIME,
+           "line " << tree[root].line << ": calling " << method_name);
+  call_stack.push_AR(&scopes[tree[method_root].slot], method_root);
   init_record(root, &computed_params);
-  if (method_root->children.size() == 2)
-    return_reference = exec_block(method_root->children[1]);
-  else {
-    return_reference = exec_block(method_root->children[0]);
-  }
+  return_value = exec_block(tree.children(method_root).back());
   call_stack.pop();
-  return return_reference;
+  if (return_value.kind == val::UNDEFINED) return val::Value(val::VOID);
+  return return_value;
 }
 
-void Interpreter::exec_if(ast::AST *root) {
-  bool b = condition(root->children[0]);
-  ast::AST *n;
+void Interpreter::exec_if(ast::node root) {
+  bool b = condition(tree.child(root, 0));
+  ast::node n;
   if (b) {
-    exec_block(root->children[1]);
-  } else if (root->children.size() > 2) {
-    for (unsigned i = 2; n = root->children[i], i < root->children.size();
-         ++i) {
-      if (n->id == ast::ELIF) {
-        if (condition(n->children[0])) {
-          exec_block(n->children[1]);
+    exec_block(tree.child(root, 1));
+  } else if (tree.children(root).size() > 2) {
+    for (unsigned i = 2; i < tree.children(root).size(); ++i) {
+      n = tree.child(root, i);
+      if (tree[n].id == ast::ELIF) {
+        if (condition(tree.child(n, 0))) {
+          exec_block(tree.child(n, 1));
           return;
         }
-      } else if (n->id == ast::ELSE) {
+      } else if (tree[n].id == ast::ELSE) {
         if (!b) {
-          exec_block(n->children[0]);
+          exec_block(tree.child(n, 0));
           return;
         }
       }
@@ -104,42 +133,41 @@ void Interpreter::exec_if(ast::AST *root) {
   }
 }
 
-void Interpreter::exec_whl(ast::AST *root) {
-  while (condition(root->children[0])) {
-    exec_block(root->children[1]);
+void Interpreter::exec_whl(ast::node root) {
+  while (condition(tree.child(root, 0))) {
+    exec_block(tree.child(root, 1));
   }
 }
 
-void Interpreter::exec_for(ast::AST *root) {
-  ast::AST *rng = root->children[0];
-  ast::AST *block = root->children[1];
-  std::string iter = rng->children[0]->token.val_str;
-  rf::Reference *from = compute(rng->children[1]);
-  rf::Reference *to = compute(rng->children[2]);
-  int fr = from->token.val_num;
-  int t = to->token.val_num;
-  call_stack.push(iter, from);
-  delete to;
+void Interpreter::exec_for(ast::node root) {
+  ast::node rng = tree.child(root, 0);
+  ast::node block = tree.child(root, 1);
+  unsigned iter = tree[tree.child(rng, 0)].slot;
+  val::Value from = compute(tree.child(rng, 1));
+  val::Value to = compute(tree.child(rng, 2));
+  if (!from.is_number() || !to.is_number())
+    error_rt("Incompatible types: " + from.type_name() + " and " +
+                 to.type_name(),
+             rng);
+  std::int64_t fr = val::to_int(from);
+  std::int64_t t = val::to_int(to);
   if (fr < t) {
     for (; fr <= t; ++fr) {
-      from->token.val_num = fr;
-      call_stack.push(iter, from);
+      call_stack.push(iter, val::Value(fr));
       exec_block(block);
     }
   } else {
     for (; fr >= t; --fr) {
-      from->token.val_num = fr;
-      call_stack.push(iter, from);
+      call_stack.push(iter, val::Value(fr));
       exec_block(block);
     }
   }
-  delete from;
 }
 
-rf::Reference *Interpreter::exec_block(ast::AST *root) {
-  rf::Reference *method;
-  for (auto &a : root->children) {
-    switch (a->id) {
+// returns an undefined value unless the block ends in a return
+val::Value Interpreter::exec_block(ast::node root) {
+  for (auto a : tree.children(root)) {
+    switch (tree[a].id) {
       case ast::ASSIGN:
         assign(a);
         break;
@@ -156,52 +184,50 @@ rf::Reference *Interpreter::exec_block(ast::AST *root) {
         exec_for(a);
         break;
       case ast::METHOD_CALL:
-        method = method_call(a);
-        delete method;
+        method_call(a);
         break;
       // case ast::INPUT: input(a); break;
       case ast::OUTPUT:
         output(a);
         break;
       case ast::RETURN:
-        return compute(a->children[0]);
+        return compute(tree.child(a, 0));
       default:
-        error("Unexpected behavior", root);
+        error("Unexpected behavior", a);
     }
   }
-  return nullptr;
+  return val::Value();
 }
 
-void Interpreter::assign(ast::AST *root) {
-  std::string var_name = root->children[0]->token.val_str;
-  ast::AST *rn = root->children[1];
-  rf::Reference *in = compute(rn);
-  if (root->children[0]->id != ast::ARR_ACC) {
-    call_stack.push(var_name, in);
+void Interpreter::assign(ast::node root) {
+  ast::node target = tree.child(root, 0);
+  val::Value in = compute(tree.child(root, 1));
+  if (tree[target].id != ast::ARR_ACC) {
+    call_stack.push(tree[target].slot, std::move(in));
   } else {
-    unsigned address =
-        compute_key(root->children[0], call_stack.peek(var_name, rn));
-    call_stack.push(var_name, address, in);
+    std::vector<val::Value> keys;
+    for (auto a : tree.children(target)) {
+      keys.push_back(compute(a));
+    }
+    unsigned address = compute_key(target, keys.data(), lookup_array(target));
+    call_stack.push(tree[target].slot, address, std::move(in));
   }
-  delete in;
 }
 
-rf::Reference *Interpreter::compute(ast::AST *root) {
-  rf::Reference *ref;
-  if (root == nullptr) return nullptr;
-  switch (root->id) {
+val::Value Interpreter::compute(ast::node root) {
+  switch (tree[root].id) {
     case ast::NUM:
-      return new rf::Reference(&root->token);
+      return val::number(tree.num(root), tree[root].num_type);
     case ast::STRING:
-      return new rf::Reference(&root->token);
+      return val::Value(tree.str(root));
     case ast::ID:
-      return new rf::Reference(call_stack.peek(root->token.val_str, root));
+      return call_stack.peek(tree[root].slot, tree[root].line);
     case ast::UN_MIN:
-      return negative(compute(root->children[0]));
+      return negative(compute(tree.child(root, 0)), root);
     case ast::STACK:
-      return new rf::Reference(ast::STACK);
+      return val::Value(val::STACK, new val::Stack);
     case ast::QUEUE:
-      return new rf::Reference(ast::QUEUE);
+      return val::Value(val::QUEUE, new val::Queue);
     case ast::ARR:
       return make_array(root);
     case ast::ARR_ACC:
@@ -210,272 +236,258 @@ rf::Reference *Interpreter::compute(ast::AST *root) {
       return declare_empty_array(root);
     case ast::STD_RETURN:
       return std_return(root);
-    case ast::BINOP:
-      return binop(compute(root->children[0]), compute(root->children[1]),
-                   root->token.id);
+    case ast::BINOP: {
+      // the left operand first, whichever order the compiler evaluates
+      // arguments in
+      val::Value l = compute(tree.child(root, 0));
+      return binop(std::move(l), compute(tree.child(root, 1)), root);
+    }
+    // the specialized variants ty::Typer made skip the type checks
+    case ast::NUM_BINOP: {
+      val::Value l = compute(tree.child(root, 0));
+      return arithmetic(l, compute(tree.child(root, 1)), root);
+    }
+    case ast::STR_CONCAT: {
+      val::Value l = compute(tree.child(root, 0));
+      return val::Value(l.str() + compute(tree.child(root, 1)).str());
+    }
     case ast::INPUT:
       return input(root);
     case ast::METHOD_CALL:
-      ref = method_call(root);
-      if (ref == nullptr)
-        return new rf::Reference(VOID_RETURN);
-      else
-        return ref;
+      return method_call(root);
   }
-  return nullptr;
+  error("Unexpected behavior", root);
+  return val::Value();
 }
 
-rf::Reference *Interpreter::binop(rf::Reference *l, rf::Reference *r, int op) {
-  int type = check_types(l, r);
-  rf::Reference *out;
-  if (type == tk::STRING) {
-    if (op == tk::PLUS) {
-      out = add(l, r);
-    } else {
-      delete l;
-      error("cannot make this type of comparison on strings", r);
-    }
-  } else if (op == tk::MINUS || op == tk::MULT || op == tk::PLUS) {
-    switch (op) {
-      case tk::PLUS:
-        out = add(l, r);
-        break;
-      case tk::MINUS:
-        out = new rf::Reference(l->token.val_num - r->token.val_num);
-        break;
-      case tk::MULT:
-        out = new rf::Reference(l->token.val_num * r->token.val_num);
-        break;
-    }
-  } else {
-    out = divide(l, r, op);
+val::Value Interpreter::binop(val::Value l, val::Value r, ast::node root) {
+  if (l.is_number() && r.is_number()) return arithmetic(l, r, root);
+  check_types(l, r, root);
+  if (l.kind == val::STR) {
+    if (tree[root].token != tk::PLUS)
+      error_rt("cannot make this type of comparison on strings", root);
+    return add(l, r);
   }
-  delete l;
-  delete r;
-  return out;
+  error_rt("cannot make this type of operation on " + l.type_name(), root);
+  return val::Value();
 }
 
-rf::Reference *Interpreter::add(rf::Reference *l, rf::Reference *r) {
-  if (l->type == tk::STRING) {
-    return new rf::Reference(l->token.val_str + r->token.val_str);
-  } else {
-    return new rf::Reference(l->token.val_num + r->token.val_num);
+val::Value Interpreter::arithmetic(const val::Value &l, const val::Value &r,
+                                   ast::node root) {
+  switch (tree[root].token) {
+    case tk::PLUS:
+      return val::add(l, r);
+    case tk::MINUS:
+      return val::subtract(l, r);
+    case tk::MULT:
+      return val::multiply(l, r);
+    default:
+      return divide(l, r, root);
   }
-  return nullptr;
 }
 
-rf::Reference *Interpreter::divide(rf::Reference *l, rf::Reference *r, int op) {
-  int a = (int)l->token.val_num;
-  int b = (int)r->token.val_num;
-  if (r->token.val_num == 0) {
-    delete l;
-    error("Division by 0 is illegal", r);
+val::Value Interpreter::add(const val::Value &l, const val::Value &r) {
+  if (l.kind == val::STR) {
+    return val::Value(l.str() + r.str());
+  } else {
+    return val::add(l, r);
   }
-  switch (op) {
+}
+
+val::Value Interpreter::divide(const val::Value &l, const val::Value &r,
+                               ast::node root) {
+  switch (tree[root].token) {
     case tk::DIV_WOQ:
-      return new rf::Reference(l->token.val_num / r->token.val_num);
+      if (val::to_double(r) == 0) error_rt("Division by 0 is illegal", root);
+      return val::divide(l, r);
     case tk::DIV_WQ:
-      return new rf::Reference(
-          (double)((int)l->token.val_num / (int)r->token.val_num));
+      if (val::to_int(r) == 0) error_rt("Division by 0 is illegal", root);
+      return val::divide_int(l, r);
     case tk::MOD:
-      return new rf::Reference((double)(a % b));
-  }
-  return nullptr;
-}
-
-int Interpreter::check_types(rf::Reference *l, rf::Reference *r) {
-  std::string error_message;
-  if (l->get_type() == r->get_type())
-    return l->get_type();
-  else {
-    error_message = ("Incompatible types: " + tk::id_to_str(l->get_type()) +
-                     " and " + tk::id_to_str(r->get_type()));
-    delete l;
-    error(error_message, r);
+      if (val::to_int(r) == 0) error_rt("Division by 0 is illegal", root);
+      return val::modulo(l, r);
+  }
+  return val::Value();
+}
+
+void Interpreter::check_types(const val::Value &l, const val::Value &r,
+                              ast::node root) {
+  if (!l.same_type(r))
+    error_rt("Incompatible types: " + l.type_name() + " and " + r.type_name(),
+             root);
+}
+
+val::Value Interpreter::negative(val::Value value, ast::node root) {
+  if (!value.is_number())
+    error_rt("Cannot make negative value from " + value.type_name(), root);
+  return val::negate(value);
+}
+
+bool Interpreter::condition(ast::node root) {
+  if (tree[root].id == ast::COND) {
+    if (tree[root].token == tk::AND)
+      return condition(tree.child(root, 0)) && condition(tree.child(root, 1));
+    else if (tree[root].token == tk::OR)
+      return condition(tree.child(root, 0)) || condition(tree.child(root, 1));
+  } else if (tree[root].id == ast::CMP) {
+    val::Value l = compute(tree.child(root, 0));
+    return numerical_comparison(std::move(l), compute(tree.child(root, 1)),
+                                root);
+  } else if (tree[root].id == ast::NUM_CMP) {
+    val::Value l = compute(tree.child(root, 0));
+    return val::compare(l, compute(tree.child(root, 1)), tree[root].token);
+  } else if (tree[root].id == ast::STR_CMP) {
+    val::Value l = compute(tree.child(root, 0));
+    return l.str() == compute(tree.child(root, 1)).str();
   }
   return false;
 }
 
-rf::Reference *Interpreter::negative(rf::Reference *val) {
-  if (val->type != tk::NUM)
-    error(("Cannot make negative value from " + tk::id_to_str(val->token.id)),
-          val);
-  rf::Reference *out = new rf::Reference(-(val->token.val_num));
-  delete val;
-  return out;
-}
-
-bool Interpreter::condition(ast::AST *root) {
-  if (root->id == ast::COND) {
-    if (root->token.id == tk::AND)
-      return condition(root->children[0]) && condition(root->children[1]);
-    else if (root->token.id == tk::OR)
-      return condition(root->children[0]) || condition(root->children[1]);
-  } else if (root->id == ast::CMP)
-    return numerical_comparison(compute(root->children[0]),
-                                compute(root->children[1]), root->token.id);
-  return false;
-}
-
-bool Interpreter::numerical_comparison(rf::Reference *l, rf::Reference *r,
-                                       int op) {
-  int type = check_types(l, r);
-  bool out;
-  if (type == tk::STRING) {
-    if (op == tk::IS)
-      out = equal(l, r);
-    else {
-      delete l;
-      error("cannot make this type of comparison on strings", r);
-    }
+bool Interpreter::numerical_comparison(val::Value l, val::Value r,
+                                       ast::node root) {
+  int op = tree[root].token;
+  check_types(l, r, root);
+  if (l.kind == val::STR) {
+    if (op != tk::IS)
+      error_rt("cannot make this type of comparison on strings", root);
+    return equal(l, r);
   }
-  switch (op) {
-    case tk::LT:
-      out = l->token.val_num < r->token.val_num;
-      break;
-    case tk::GT:
-      out = l->token.val_num > r->token.val_num;
-      break;
-    case tk::LEQ:
-      out = l->token.val_num <= r->token.val_num;
-      break;
-    case tk::GEQ:
-      out = l->token.val_num >= r->token.val_num;
-      break;
-    case tk::DNEQ:
-      out = l->token.val_num != r->token.val_num;
-      break;
-    case tk::IS:
-      out = equal(l, r);
-      break;
-  }
-  delete l;
-  delete r;
-  return out;
+  if (!l.is_number())
+    error_rt("cannot make this type of comparison on " + l.type_name(), root);
+  return val::compare(l, r, op);
 }
 
-bool Interpreter::equal(rf::Reference *l, rf::Reference *r) {
-  bool out;
-  if (l->type == tk::STRING)
-    out = l->token.val_str == r->token.val_str;
-  else if (l->type == tk::NUM)
-    out = l->token.val_num == r->token.val_num;
-  return out;
+bool Interpreter::equal(const val::Value &l, const val::Value &r) {
+  if (l.kind == val::STR) return l.str() == r.str();
+  return val::compare(l, r, tk::IS);
 }
 
-rf::Reference *Interpreter::declare_empty_array(ast::AST *root) {
-  rf::Reference *arr = new rf::Reference;
-  rf::Reference *arg;
-  unsigned size = 1;
-  for (auto &a : root->children) {
-    arg = compute(a);
-    if (arg->type != tk::NUM) error("Only viable argument is a number", a);
-    size *= arg->token.val_num;
-    arr->push_dimension(arg->token.val_num);
-    delete arg;
+val::Value Interpreter::declare_empty_array(ast::node root) {
+  val::Array *arr = new val::Array;
+  val::Value out(val::ARR, arr);
+  std::size_t size = 1;
+  for (auto a : tree.children(root)) {
+    val::Value arg = compute(a);
+    if (!arg.is_number() || val::to_double(arg) < 0)
+      error("Only viable argument is a number", root);
+    arr->dims.push_back(val::to_int(arg));
+    size *= arr->dims.back();
   }
-  for (unsigned i = 0; i < size; ++i) {
-    arr->push_zero();
-  }
-  arr->type = ast::ARR;
-  return arr;
+  arr->zeros(size);
+  return out;
 }
 
-rf::Reference *Interpreter::make_array(ast::AST *root) {
-  rf::Reference *arr = new rf::Reference;
+// the shape is checked before any element is evaluated
+val::Value Interpreter::make_array(ast::node root) {
+  val::Array *arr = new val::Array;
+  val::Value out(val::ARR, arr);
+  std::vector<ast::node> elements;
   get_dimensions(root, arr);
-  get_contents(root, arr, 0);
-  arr->type = ast::ARR;
-  return arr;
+  get_contents(root, arr, 0, elements);
+  arr->nums.reserve(elements.size());
+  for (auto a : elements) {
+    arr->push(compute(a));
+  }
+  return out;
 }
 
-void Interpreter::get_contents(ast::AST *root, rf::Reference *arr,
-                               unsigned nesting) {
-  if (root == nullptr) return;
-  if (root->children.size() != arr->s[nesting]) {
+void Interpreter::get_contents(ast::node root, val::Array *arr,
+                               unsigned nesting,
+                               std::vector<ast::node> &elements) {
+  if (tree.children(root).size() != arr->dims[nesting]) {
     error("ragged array", root);
   }
-  for (auto &a : root->children) {
-    if (a->id == ast::ARR) {
-      get_contents(a, arr, nesting + 1);
-    } else if (nesting == arr->s.size() - 1) {
-      arr->push_contents(compute(a));
+  for (auto a : tree.children(root)) {
+    if (tree[a].id == ast::ARR && nesting + 1 < arr->dims.size()) {
+      get_contents(a, arr, nesting + 1, elements);
+    } else if (tree[a].id != ast::ARR && nesting == arr->dims.size() - 1) {
+      elements.push_back(a);
     } else {
       error("inconsistent array nesting", root);
     }
   }
 }
 
-void Interpreter::get_dimensions(ast::AST *root, rf::Reference *arr) {
-  while (root->id == ast::ARR) {
-    arr->push_dimension(root->children.size());
-    root = root->children[0];
+void Interpreter::get_dimensions(ast::node root, val::Array *arr) {
+  while (tree[root].id == ast::ARR) {
+    arr->dims.push_back(tree.children(root).size());
+    if (tree.children(root).empty()) break;
+    root = tree.child(root, 0);
   }
 }
 
-rf::Reference *Interpreter::access_array(ast::AST *root) {
-  rf::Reference *arr = call_stack.peek(root->token.val_str, root);
-  unsigned addr = compute_key(root, arr);
-  return new rf::Reference(arr->get_array_element(addr));
+val::Value Interpreter::access_array(ast::node root) {
+  std::vector<val::Value> keys;
+  for (auto a : tree.children(root)) {
+    keys.push_back(compute(a));
+  }
+  val::Array *arr = lookup_array(root);
+  return arr->get(compute_key(root, keys.data(), arr));
 }
 
-unsigned Interpreter::compute_key(ast::AST *accessor, rf::Reference *arr) {
-  rf::Reference *computed_node;
-  unsigned addr = 1, nod;  // number of dimensions
-  if ((nod = accessor->children.size()) == arr->s.size()) {
-    for (unsigned i = 0; i < nod - 1; ++i) {
-      computed_node = compute(accessor->children[i]);
-      addr *= computed_node->token.val_num * arr->s[i];
-      delete computed_node;
-    }
-    computed_node = compute(accessor->children[nod - 1]);
-    if (addr == 0)
-      addr += computed_node->token.val_num;
-    else if (addr == 1)
-      addr = computed_node->token.val_num;
-    else
-      addr += computed_node->token.val_num;
-    delete computed_node;
-    if (addr > arr->adt.size() - 1 || addr < 0) {
-      error(("index " + std::to_string(addr) + " out of bounds"), accessor);
-    }
+val::Array *Interpreter::lookup_array(ast::node accessor) {
+  val::Value &arr = call_stack.peek(tree[accessor].slot, tree[accessor].line);
+  if (arr.kind != val::ARR)
+    error(tree.str(accessor) + " is not an array", accessor);
+  return val::as_array(arr);
+}
+
+// row-major address of the element, every key is checked against its
+// dimension
+unsigned Interpreter::compute_key(ast::node accessor, val::Value *keys,
+                                  val::Array *arr) {
+  unsigned nod = tree.children(accessor).size();  // number of dimensions
+  unsigned addr = 0;
+  long long key;
+  if (nod != arr->dims.size())
+    error("array has " + std::to_string(arr->dims.size()) + " dimensions, " +
+              std::to_string(nod) + " indices given",
+          accessor);
+  for (unsigned i = 0; i < nod; ++i) {
+    if (!keys[i].is_number())
+      error("Only viable argument is a number", accessor);
+    key = val::to_int(keys[i]);
+    if (key < 0 || key >= arr->dims[i])
+      error("index " + std::to_string(key) + " out of bounds", accessor);
+    addr = addr * arr->dims[i] + key;
   }
   return addr;
 }
 
-void Interpreter::std_void(ast::AST *root) {
-  switch (root->children[0]->children[0]->token.id) {
+void Interpreter::std_void(ast::node root) {
+  ast::node std_method = tree.children(tree.child(root, 0)).back();
+  if (tree.children(std_method).empty())
+    error("Unexpected behavior", std_method);
+  switch (tree[std_method].token) {
     case tk::PUSH:
-      push(root->children[0]);
+      push(tree.child(root, 0));
       break;
     case tk::ENQUEUE:
-      enqueue(root->children[0]);
+      enqueue(tree.child(root, 0));
       break;
   }
 }
 
-void Interpreter::push(ast::AST *root) {
-  rf::Reference *ref = call_stack.peek(root->token.val_str, root);
-  if (ref->type == ast::STACK) {
-    ref->push_contents(compute(root->children[0]->children[0]));
-    ref->s[0] += 1;
-  } else {
+void Interpreter::push(ast::node root) {
+  val::Value in = compute(tree.child(tree.children(root).back(), 0));
+  val::Value &ref = call_stack.peek(tree[root].slot, tree[root].line);
+  if (ref.kind != val::STACK)
     error("'push' can only be done on a stack", root);
-  }
+  ref.detach();
+  val::as_stack(ref)->push(std::move(in));
 }
 
-void Interpreter::enqueue(ast::AST *root) {
-  rf::Reference *ref = call_stack.peek(root->token.val_str, root);
-  if (ref->type == ast::QUEUE) {
-    ref->push_contents(compute(root->children[0]->children[0]));
-    ref->s[0] += 1;
-  } else {
+void Interpreter::enqueue(ast::node root) {
+  val::Value in = compute(tree.child(tree.children(root).back(), 0));
+  val::Value &ref = call_stack.peek(tree[root].slot, tree[root].line);
+  if (ref.kind != val::QUEUE)
     error("'enqueue' can only be done on a queue", root);
-  }
+  ref.detach();
+  val::as_queue(ref)->enqueue(std::move(in));
 }
 
-rf::Reference *Interpreter::std_return(ast::AST *root) {
-  switch (root->children[0]->token.id) {
+val::Value Interpreter::std_return(ast::node root) {
+  switch (tree[tree.children(root).back()].token) {
     case tk::LENGTH:
       return length(root);
     case tk::POP:
@@ -484,131 +496,118 @@ rf::Reference *Interpreter::std_return(ast::AST *root) {
       return dequeue(root);
     case tk::GET_NEXT:
       return get_next(root);
+    case tk::HAS_NEXT:
+      return has_next(root);
     case tk::IS_EMPTY:
       return empty(root);
   }
-  return nullptr;
+  error("Unexpected behavior", root);
+  return val::Value();
 }
 
-rf::Reference *Interpreter::length(ast::AST *root) {
-  rf::Reference *arr = call_stack.peek(root->token.val_str, root);
-  double len = 1;
-  for (auto &a : arr->s) {
-    len *= a;
-  }
-  return new rf::Reference(len);
+val::Value Interpreter::length(ast::node root) {
+  return val::Value(
+      val::length(call_stack.peek(tree[root].slot, tree[root].line)));
 }
 
-rf::Reference *Interpreter::pop(ast::AST *root) {
-  rf::Reference *stk = call_stack.peek(root->token.val_str, root);
-  if (stk->type != ast::STACK)
+val::Value Interpreter::pop(ast::node root) {
+  val::Value &stk = call_stack.peek(tree[root].slot, tree[root].line);
+  if (stk.kind != val::STACK)
     error("'pop' can only be performed on stacks", root);
-  if (!stk->adt.empty()) {
-    return stk->pop();
-  } else {
+  if (val::length(stk) == 0)
     error("Cannot perform 'pop' on an empty stack", root);
-  }
-  return nullptr;
+  stk.detach();
+  return val::as_stack(stk)->pop();
 }
 
-rf::Reference *Interpreter::dequeue(ast::AST *root) {
-  rf::Reference *que = call_stack.peek(root->token.val_str, root);
-  if (que->type != ast::QUEUE)
+val::Value Interpreter::dequeue(ast::node root) {
+  val::Value &que = call_stack.peek(tree[root].slot, tree[root].line);
+  if (que.kind != val::QUEUE)
     error("'dequeue' can only be performed on queues", root);
-  if (!que->adt.empty()) {
-    return que->dequeue();
-  } else {
+  if (val::length(que) == 0)
     error("Cannot perform 'pop' on an empty stack", root);
-  }
-  return nullptr;
+  que.detach();
+  return val::as_queue(que)->dequeue();
 }
 
-rf::Reference *Interpreter::get_next(ast::AST *root) {
-  rf::Reference *ref = call_stack.peek(root->token.val_str, root);
-  if (!ref->adt.empty()) {
-    if (ref->type == ast::STACK) {
-      return new rf::Reference(ref->adt.front());
-    } else if (ref->type == ast::QUEUE) {
-      return new rf::Reference(ref->adt.back());
-    } else {
-      error("'getNext()' can only be perfromed on a stack or a queue", root);
-    }
-  } else {
+val::Value Interpreter::get_next(ast::node root) {
+  val::Value &ref = call_stack.peek(tree[root].slot, tree[root].line);
+  if (!ref.is_container() || val::length(ref) == 0)
     error("cannot perform 'getNext()' on an empty container", root);
-  }
-  return nullptr;
+  if (ref.kind == val::ARR)
+    error("'getNext()' can only be perfromed on a stack or a queue", root);
+  if (ref.kind == val::STACK) return val::as_stack(ref)->next();
+  return val::as_queue(ref)->next();
 }
 
-rf::Reference *Interpreter::empty(ast::AST *root) {
-  rf::Reference *ref = call_stack.peek(root->token.val_str, root);
-  if (ref->adt.empty())
-    return new rf::Reference(1.f);
-  else
-    return new rf::Reference(0.f);
+val::Value Interpreter::has_next(ast::node root) {
+  val::Value &ref = call_stack.peek(tree[root].slot, tree[root].line);
+  return val::Value(
+      (std::int64_t)(ref.is_container() && val::length(ref) > 0 ? 1 : 0));
 }
 
-ast::AST *Interpreter::lookup_method(std::string key, ast::AST *leaf) {
+val::Value Interpreter::empty(ast::node root) {
+  val::Value &ref = call_stack.peek(tree[root].slot, tree[root].line);
+  return val::Value(
+      (std::int64_t)(ref.is_container() && val::length(ref) > 0 ? 0 : 1));
+}
+
+ast::node Interpreter::lookup_method(std::string key, ast::node leaf) {
   method_map::iterator it;
   if ((it = methods.find(key)) != methods.end()) {
     return it->second;
   } else {
     error(("Undefined reference to method " + key), leaf);
   }
-  return NULL;
+  return ast::NONE;
 }
 
-void Interpreter::collect_params(ast::AST *root,
-                                 std::vector<rf::Reference *> *container) {
-  if (root->id == ast::PARAM)
-    for (auto &a : root->children) {
+void Interpreter::collect_params(ast::node root,
+                                 std::vector<val::Value> *container) {
+  if (tree[root].id == ast::PARAM)
+    for (auto a : tree.children(root)) {
       container->push_back(compute(a));
     }
 }
 
-void Interpreter::init_record(ast::AST *root,
-                              std::vector<rf::Reference *> *params) {
-  ast::AST *method_root = call_stack.peek_for_root();
-  if (method_root->children[0]->id != ast::BLOCK) {
-    ast::AST *param_proto = method_root->children[0];
-    std::string param_name;
-    if (params->size() == param_proto->children.size()) {
+void Interpreter::init_record(ast::node root, std::vector<val::Value> *params) {
+  ast::node method_root = call_stack.peek_for_root();
+  if (tree[tree.child(method_root, 0)].id != ast::BLOCK) {
+    ast::node param_proto = tree.child(method_root, 0);
+    if (params->size() == tree.children(param_proto).size()) {
       for (unsigned i = 0; i < params->size(); ++i) {
-        param_name = param_proto->children[i]->token.val_str;
-        call_stack.push(param_name, params->at(i));
+        call_stack.push(tree[tree.child(param_proto, i)].slot,
+                        std::move(params->at(i)));
       }
     } else {
       error(("Incorrect number of arguments in the call of function " +
              call_stack.peek_for_name()),
             root);
     }
-    for (auto &a : *params) {
-      delete a;
-    }
   }
 }
 
-void Interpreter::output(ast::AST *root) {
-  rf::Reference *output;
-  for (auto &a : root->children) {
-    output = compute(a);
-    output->print();
-    delete output;
+void Interpreter::output(ast::node root) {
+  for (auto a : tree.children(root)) {
+    compute(a).print();
   }
   std::cout << std::endl;
 }
 
-rf::Reference *Interpreter::input(ast::AST *root) {
-  std::cout << root->children[0]->token.val_str;
+val::Value Interpreter::input(ast::node root) {
+  std::cout << tree.str(tree.child(root, 0));
   std::string buffer;
   std::cin >> buffer;
-  buffer.push_back('\0');
+  // a failed read is reported as the unexpected character it leaves behind
+  if (buffer.empty()) buffer.push_back('\0');
   std::cout << std::endl;
   lxr::Lexer lex(buffer);
   tk::Token token;
   if (!lex.get_next_token(token)) {
     error(lex.get_error().message, root);
   }
-  return new rf::Reference(&token);
+  if (token.id == tk::NUM) return val::number(token);
+  return val::Value(token.val_str, token.id);
 }
 
 void Interpreter::print_methods() {
@@ -2,7 +2,8 @@
 
 namespace tk {
 
-Token::Token(Token &tok) : id(tok.id), line(tok.line) {
+Token::Token(Token &tok)
+    : id(tok.id), num_type(tok.num_type), line(tok.line) {
   if (id == NUM)
     val_num = tok.val_num;
   else if (id >= PLUS && id <= COMMA)
@@ -11,7 +12,8 @@ Token::Token(Token &tok) : id(tok.id), line(tok.line) {
     val_str = tok.val_str;
 }
 
-Token::Token(Token *tok) : id(tok->id), line(tok->line) {
+Token::Token(Token *tok)
+    : id(tok->id), num_type(tok->num_type), line(tok->line) {
   if (id == NUM)
     val_num = tok->val_num;
   else if (id >= PLUS && id <= COMMA)
@@ -83,157 +85,8 @@ Token Token::operator+(Token &t) {
 }
 
 std::string id_to_str(int id) {
-  std::string out;
-  switch (id) {
-    case END_FILE:
-      out = "EOF";
-      break;
-    case PLUS:
-      out = "+";
-      break;
-    case MINUS:
-      out = "-";
-      break;
-    case MULT:
-      out = "*";
-      break;
-    case DIV_WOQ:
-      out = "/";
-      break;
-    case DIV_WQ:
-      out = "div";
-      break;
-    case MOD:
-      out = "mod";
-      break;
-    case LSQBR:
-      out = "[";
-      break;
-    case RSQBR:
-      out = "]";
-      break;
-    case LPAREN:
-      out = "(";
-      break;
-    case RPAREN:
-      out = ")";
-      break;
-    case QTMARK:
-      out = "\"";
-      break;
-    case LT:
-      out = "<";
-      break;
-    case GT:
-      out = ">";
-      break;
-    case LEQ:
-      out = "<=";
-      break;
-    case GEQ:
-      out = ">=";
-      break;
-    case EQ:
-      out = "=";
-      break;
-    case DNEQ:
-      out = "!=";
-      break;
-    case IS:
-      out = "==";
-      break;
-    case DOT:
-      out = ".";
-      break;
-    case COMMA:
-      out = ",";
-      break;
-    case NUM:
-      out = "NUM";
-      break;
-    case STRING:
-      out = "STRING";
-      break;
-    case ID_VAR:
-      out = "ID_VAR";
-      break;
-    case ID_METHOD:
-      out = "ID_METHOD";
-      break;
-    case AND:
-      out = "AND";
-      break;
-    case OR:
-      out = "OR";
-      break;
-    case METHOD:
-      out = "method";
-      break;
-    case RETURN:
-      out = "return";
-      break;
-    case LOOP:
-      out = "loop";
-      break;
-    case FROM:
-      out = "from";
-      break;
-    case TO:
-      out = "to";
-      break;
-    case WHILE:
-      out = "while";
-      break;
-    case UNTIL:
-      out = "until";
-      break;
-    case IF:
-      out = "if";
-      break;
-    case THEN:
-      out = "then";
-      break;
-    case ELSE:
-      out = "else";
-      break;
-    case END:
-      out = "end";
-      break;
-    case OUTPUT:
-      out = "output";
-      break;
-    case INPUT:
-      out = "intput";
-      break;
-    case LENGTH:
-      out = "length";
-      break;
-    case GET_NEXT:
-      out = "get_next";
-      break;
-    case POP:
-      out = "pop";
-      break;
-    case DEQUEUE:
-      out = "dequeue";
-      break;
-    case HAS_NEXT:
-      out = "has_next";
-      break;
-    case PUSH:
-      out = "push";
-      break;
-    case ENQUEUE:
-      out = "enqueue";
-      break;
-    case IS_EMPTY:
-      out = "is_empty";
-      break;
-    default:
-      out = "NULL";
-      break;
-  }
-  return out;
+  if (id < 0 || id >= (int)std::size(ID_NAMES)) return "NULL";
+  return std::string(ID_NAMES[id]);
 }
 
 void print_token(Token *token) {
@@ -245,12 +98,4 @@ void print_token(Token *token) {
   std::cout << ">" << std::endl;
 }
 
-int lookup_keyword(std::string lexeme) {
-  if (RESERVED_KEYWORDS.find(lexeme) != RESERVED_KEYWORDS.end()) {
-    return RESERVED_KEYWORDS.at(lexeme);
-  } else {
-    return 0;
-  }
-}
-
 }  // namespace tk
@@ -0,0 +1,297 @@
+#include "../include/typer.hpp"
+
+namespace ty {
+
+namespace {
+
+void join(env &into, const env &other) {
+  for (unsigned i = 0; i < into.size(); ++i) {
+    into[i] |= other[i];
+  }
+}
+
+}  // namespace
+
+Typer::Typer(ast::Tree &tree, rsv::scopes &scopes)
+    : tree(tree), scopes(scopes) {}
+
+void Typer::specialize() {
+  std::vector<ast::node> methods;
+  vars.assign(scopes[tree[tree.root].slot].locals.size(), UNDEFINED);
+  for (auto a : tree.children(tree.root)) {
+    switch (tree[a].id) {
+      case ast::METHOD:
+        methods.push_back(a);
+        break;
+      case ast::ASSIGN:
+      case ast::STD_VOID:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::FOR:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        stmt(a);
+        break;
+    }
+  }
+  for (auto a : methods) {
+    method(a);
+  }
+}
+
+void Typer::specialize(ast::node root) { method(root); }
+
+// the arguments of a call can be anything but undefined
+void Typer::method(ast::node root) {
+  ast::Children children = tree.children(root);
+  if (children.empty() || tree[children.back()].id != ast::BLOCK) return;
+  const rsv::Scope &scope = scopes[tree[root].slot];
+  vars.assign(scope.locals.size(), UNDEFINED);
+  for (unsigned i = 0; i < scope.params; ++i) {
+    vars[i] = ANY;
+  }
+  block(children.back());
+}
+
+void Typer::stmt(ast::node root) {
+  ast::node target, n;
+  switch (tree[root].id) {
+    case ast::ASSIGN: {
+      types in = expr(tree.child(root, 1));
+      target = tree.child(root, 0);
+      if (tree[target].id == ast::ARR_ACC) {
+        expr(target);
+      } else {
+        vars[tree[target].slot] = in;
+      }
+      break;
+    }
+    case ast::STD_VOID:
+      target = tree.child(root, 0);
+      n = tree.children(target).back();
+      if (tree.children(n).empty() ||
+          (tree[n].token != tk::PUSH && tree[n].token != tk::ENQUEUE))
+        break;
+      expr(tree.child(n, 0));
+      read(target);
+      vars[tree[target].slot] &= tree[n].token == tk::PUSH ? STACK : QUEUE;
+      break;
+    case ast::IF: {
+      condition(tree.child(root, 0));
+      env rest = vars;
+      block(tree.child(root, 1));
+      env out = vars;
+      bool otherwise = false;
+      for (unsigned i = 2; i < tree.children(root).size() && !otherwise; ++i) {
+        n = tree.child(root, i);
+        vars = rest;
+        if (tree[n].id == ast::ELIF) {
+          condition(tree.child(n, 0));
+          rest = vars;
+          block(tree.child(n, 1));
+        } else {
+          block(tree.child(n, 0));
+          otherwise = true;
+        }
+        join(out, vars);
+      }
+      if (!otherwise) join(out, rest);
+      vars = std::move(out);
+      break;
+    }
+    case ast::WHILE:
+      loop(tree.child(root, 0), tree.child(root, 1));
+      break;
+    case ast::FOR:
+      n = tree.child(root, 0);
+      expr(tree.child(n, 1));
+      expr(tree.child(n, 2));
+      loop(n, tree.child(root, 1));
+      break;
+    case ast::OUTPUT:
+      exprs(root);
+      break;
+    default:
+      expr(root);
+  }
+}
+
+// a return ends the block, so does a statement the interpreter rejects
+void Typer::block(ast::node root) {
+  for (auto a : tree.children(root)) {
+    switch (tree[a].id) {
+      case ast::ASSIGN:
+      case ast::STD_VOID:
+      case ast::IF:
+      case ast::WHILE:
+      case ast::FOR:
+      case ast::METHOD_CALL:
+      case ast::OUTPUT:
+        stmt(a);
+        break;
+      case ast::RETURN:
+        expr(tree.child(a, 0));
+        return;
+      default:
+        return;
+    }
+  }
+}
+
+// head holds the sets at the start of every iteration, it is grown by the
+// sets at the end of the body until it stays the same. head is the RANGE of a
+// counting loop, which sets its variable at the start of every iteration and
+// runs the body at least once, or the condition of a while loop.
+void Typer::loop(ast::node head, ast::node body) {
+  bool counting = tree[head].id == ast::RANGE;
+  unsigned iter = counting ? tree[tree.child(head, 0)].slot : 0;
+  bool was_final = final;
+  env start = vars;
+  final = false;
+  for (;;) {
+    vars = start;
+    if (counting)
+      vars[iter] = NUM;
+    else
+      condition(head);
+    block(body);
+    env next = start;
+    join(next, vars);
+    if (next == start) break;
+    start = std::move(next);
+  }
+  final = was_final;
+  vars = std::move(start);
+  if (counting) {
+    vars[iter] = NUM;
+    block(body);
+  } else {
+    condition(head);
+    env out = vars;
+    block(body);
+    vars = std::move(out);
+  }
+}
+
+// the right operand of AND and OR may not be computed at all
+void Typer::condition(ast::node root) {
+  switch (tree[root].id) {
+    case ast::COND:
+      if (tree[root].token == tk::AND || tree[root].token == tk::OR) {
+        condition(tree.child(root, 0));
+        env left = vars;
+        condition(tree.child(root, 1));
+        join(vars, left);
+      }
+      break;
+    case ast::CMP:
+    case ast::NUM_CMP:
+    case ast::STR_CMP:
+      comparison(root);
+      break;
+  }
+}
+
+void Typer::comparison(ast::node root) {
+  types l = expr(tree.child(root, 0));
+  types r = expr(tree.child(root, 1));
+  if (!final) return;
+  if (l == NUM && r == NUM)
+    tree[root].id = ast::NUM_CMP;
+  else if (l == STRING && r == STRING && tree[root].token == tk::IS)
+    tree[root].id = ast::STR_CMP;
+}
+
+types Typer::expr(ast::node root) {
+  if (root == ast::NONE) return 0;
+  switch (tree[root].id) {
+    case ast::NUM:
+      return NUM;
+    case ast::STRING:
+      return STRING;
+    case ast::ID:
+      return read(root);
+    case ast::UN_MIN:
+      return expr(tree.child(root, 0)) & NUM;
+    case ast::STACK:
+      return STACK;
+    case ast::QUEUE:
+      return QUEUE;
+    case ast::ARR:
+    case ast::ARR_DYN:
+      exprs(root);
+      return ARR;
+    case ast::ARR_ACC:
+      exprs(root);
+      read(root);
+      vars[tree[root].slot] &= ARR;
+      return ANY;
+    case ast::STD_RETURN:
+      return std_return(root);
+    case ast::BINOP:
+    case ast::NUM_BINOP:
+    case ast::STR_CONCAT:
+      return binop(root);
+    case ast::INPUT:
+      return NUM | STRING | TEXT;
+    case ast::METHOD_CALL:
+      if (!tree.children(root).empty() &&
+          tree[tree.child(root, 0)].id == ast::PARAM)
+        exprs(tree.child(root, 0));
+      return ANY;
+  }
+  return 0;
+}
+
+void Typer::exprs(ast::node root) {
+  for (auto a : tree.children(root)) {
+    expr(a);
+  }
+}
+
+// numbers add up to numbers, strings to a STRING whatever their ids
+types Typer::binop(ast::node root) {
+  types l = expr(tree.child(root, 0));
+  types r = expr(tree.child(root, 1));
+  int op = tree[root].token;
+  types out = 0;
+  if ((l & NUM) && (r & NUM)) out |= NUM;
+  if (op == tk::PLUS && (l & (STRING | TEXT)) && (r & (STRING | TEXT)))
+    out |= STRING;
+  if (!final) return out;
+  if (l == NUM && r == NUM)
+    tree[root].id = ast::NUM_BINOP;
+  else if (l == STRING && r == STRING && op == tk::PLUS)
+    tree[root].id = ast::STR_CONCAT;
+  return out;
+}
+
+// a variable read past this point is defined, reading it fails otherwise
+types Typer::read(ast::node leaf) {
+  types &t = vars[tree[leaf].slot];
+  t &= ~UNDEFINED;
+  return t;
+}
+
+types Typer::std_return(ast::node root) {
+  read(root);
+  types &t = vars[tree[root].slot];
+  switch (tree[tree.children(root).back()].token) {
+    case tk::LENGTH:
+    case tk::HAS_NEXT:
+    case tk::IS_EMPTY:
+      return NUM;
+    case tk::POP:
+      t &= STACK;
+      return ANY;
+    case tk::DEQUEUE:
+      t &= QUEUE;
+      return ANY;
+    case tk::GET_NEXT:
+      t &= STACK | QUEUE;
+      return ANY;
+  }
+  return 0;
+}
+
+}  // namespace ty
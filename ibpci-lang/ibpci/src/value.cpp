@@ -0,0 +1,252 @@
+#include "../include/value.hpp"
+
+namespace val {
+
+Value::Value(std::string str, int id)
+    : kind(STR), obj(new String(std::move(str), id)) {}
+
+void Value::copy() {
+  Object *copy = obj->clone();
+  obj->refs--;
+  obj = copy;
+}
+
+int Value::type_id() const {
+  switch (kind) {
+    case INT:
+    case NUM:
+      return tk::NUM;
+    case STR:
+      return static_cast<String *>(obj)->id;
+    default:
+      return -1;
+  }
+}
+
+bool Value::same_type(const Value &v) const {
+  if (kind != v.kind) return is_number() && v.is_number();
+  return kind != STR || type_id() == v.type_id();
+}
+
+std::string Value::type_name() const {
+  switch (kind) {
+    case INT:
+    case NUM:
+    case STR:
+      return tk::id_to_str(type_id());
+    case ARR:
+      return "ARRAY";
+    case STACK:
+      return "STACK";
+    case QUEUE:
+      return "QUEUE";
+    case VOID:
+      return "VOID";
+    default:
+      return "UNDEFINED";
+  }
+}
+
+const std::string &Value::str() const {
+  return static_cast<String *>(obj)->str;
+}
+
+void Value::print() const {
+  switch (kind) {
+    case INT:
+      std::cout << (double)i;
+      break;
+    case NUM:
+      std::cout << num;
+      break;
+    case STR:
+      std::cout << str();
+      break;
+    case ARR:
+      as_array(*this)->print();
+      break;
+    case STACK:
+    case QUEUE:
+      as_sequence(*this)->print();
+      break;
+    default:
+      break;
+  }
+}
+
+Object *String::clone() { return new String(str, id); }
+
+void Array::push(Value v) {
+  widen(v);
+  switch (kind) {
+    case INTS:
+      ints.push_back(v.i);
+      break;
+    case NUMS:
+      nums.push_back(to_double(v));
+      break;
+    default:
+      values.push_back(std::move(v));
+  }
+}
+
+// a fresh buffer instead of assign() keeps the zeroing to calloc
+void Array::zeros(std::size_t count) {
+  kind = INTS;
+  values.clear();
+  nums.clear();
+  ints = int_buffer(count);
+}
+
+void Array::print() const {
+  switch (kind) {
+    case INTS:
+      for (auto a : ints) {
+        std::cout << (double)a << " ";
+      }
+      break;
+    case NUMS:
+      for (auto a : nums) {
+        std::cout << a << " ";
+      }
+      break;
+    default:
+      for (auto &a : values) {
+        a.print();
+        std::cout << " ";
+      }
+  }
+}
+
+// moves the elements into the narrowest storage that can also hold v
+void Array::widen(const Value &v) {
+  if (kind == VALUES || (kind == NUMS && v.is_number()) ||
+      (kind == INTS && v.kind == INT))
+    return;
+  if (kind == INTS && v.kind == NUM) {
+    nums.assign(ints.begin(), ints.end());
+    kind = NUMS;
+  } else {
+    values.reserve(size());
+    if (kind == INTS)
+      for (auto a : ints) values.emplace_back(a);
+    else
+      for (auto a : nums) values.emplace_back(a);
+    nums = num_buffer();
+    kind = VALUES;
+  }
+  ints = int_buffer();
+}
+
+void Array::widen_set(std::size_t i, Value v) {
+  widen(v);
+  if (kind == NUMS)
+    nums[i] = to_double(v);
+  else
+    values[i] = std::move(v);
+}
+
+Object *Array::clone() { return new Array(*this); }
+
+void Sequence::grow() {
+  std::vector<Value> grown(buffer.empty() ? 8 : buffer.size() * 2);
+  for (std::size_t i = 0; i < count; ++i) {
+    grown[i] = std::move(buffer[(head + i) & mask()]);
+  }
+  buffer.swap(grown);
+  head = 0;
+}
+
+void Sequence::print() const {
+  for (std::size_t i = 0; i < count; ++i) {
+    buffer[(head + i) & mask()].print();
+    std::cout << " ";
+  }
+}
+
+Object *Stack::clone() { return new Stack(*this); }
+
+Object *Queue::clone() { return new Queue(*this); }
+
+std::int64_t length(const Value &v) {
+  switch (v.kind) {
+    case ARR:
+      return as_array(v)->size();
+    case STACK:
+    case QUEUE:
+      return as_sequence(v)->size();
+    case VOID:
+      return 0;
+    default:
+      return 1;
+  }
+}
+
+Value number(double num, int num_type) {
+  if (num_type == tk::INT) return Value((std::int64_t)num);
+  return Value(num);
+}
+
+Value number(const tk::Token &token) {
+  return number(token.val_num, token.num_type);
+}
+
+Value divide(const Value &l, const Value &r) {
+  if (l.kind == INT && r.kind == INT && r.i != -1 && l.i % r.i == 0)
+    return Value(l.i / r.i);
+  return Value(to_double(l) / to_double(r));
+}
+
+Value divide_int(const Value &l, const Value &r) {
+  std::int64_t a = to_int(l), b = to_int(r);
+  if (b == -1) return negate(Value(a));
+  return Value(a / b);
+}
+
+Value modulo(const Value &l, const Value &r) {
+  std::int64_t a = to_int(l), b = to_int(r);
+  if (b == -1) return Value((std::int64_t)0);
+  return Value(a % b);
+}
+
+Value negate(const Value &v) {
+  if (v.kind == NUM) return Value(-v.num);
+  if (v.i == INT64_MIN) return Value(-(double)v.i);
+  return Value(-v.i);
+}
+
+bool compare(const Value &l, const Value &r, int op) {
+  if (l.kind == INT && r.kind == INT) {
+    switch (op) {
+      case tk::LT:
+        return l.i < r.i;
+      case tk::GT:
+        return l.i > r.i;
+      case tk::LEQ:
+        return l.i <= r.i;
+      case tk::GEQ:
+        return l.i >= r.i;
+      case tk::DNEQ:
+        return l.i != r.i;
+      default:
+        return l.i == r.i;
+    }
+  }
+  double a = to_double(l), b = to_double(r);
+  switch (op) {
+    case tk::LT:
+      return a < b;
+    case tk::GT:
+      return a > b;
+    case tk::LEQ:
+      return a <= b;
+    case tk::GEQ:
+      return a >= b;
+    case tk::DNEQ:
+      return a != b;
+    default:
+      return a == b;
+  }
+}
+
+}  // namespace val
@@ -0,0 +1,467 @@
+#include "../include/vm.hpp"
+
+namespace IBPCI {
+
+VM::VM(bc::Program &program) : program(program) {
+  methods.assign(program.method_names.size(), -1);
+}
+
+void VM::error(std::string message, int kind, unsigned line) {
+  if (kind == bc::SEMANTIC_ERROR)
+    std::cout << "SEMANTIC ERROR at line ";
+  else
+    std::cout << "RUN-TIME error at line ";
+  std::cout << line << ": " << message << std::endl;
+  exit(1);
+}
+
+void VM::error_uref(const bc::Chunk *chunk, unsigned slot, unsigned line) {
+  error("undefined reference to variable " + chunk->locals[slot],
+        bc::RUNTIME_ERROR, line);
+}
+
+void VM::reserve(std::size_t size) {
+  if (size > stack.size()) stack.resize(std::max(size, stack.size() * 2));
+}
+
+void VM::arith(val::Value *l, val::Value *r, int op, unsigned line) {
+  if (!l->same_type(*r))
+    error("Incompatible types: " + l->type_name() + " and " + r->type_name(),
+          bc::RUNTIME_ERROR, line);
+  if (l->kind == val::STR) {
+    if (op != bc::ADD)
+      error("cannot make this type of comparison on strings",
+            bc::RUNTIME_ERROR, line);
+    *l = val::Value(l->str() + r->str());
+    *r = val::Value();
+    return;
+  }
+  if (!l->is_number())
+    error("cannot make this type of operation on " + l->type_name(),
+          bc::RUNTIME_ERROR, line);
+  switch (op) {
+    case bc::ADD:
+      *l = val::add(*l, *r);
+      break;
+    case bc::SUB:
+      *l = val::subtract(*l, *r);
+      break;
+    case bc::MUL:
+      *l = val::multiply(*l, *r);
+      break;
+    case bc::DIV:
+      if (val::to_double(*r) == 0)
+        error("Division by 0 is illegal", bc::RUNTIME_ERROR, line);
+      *l = val::divide(*l, *r);
+      break;
+    case bc::DIV_INT:
+    case bc::MOD:
+      if (val::to_int(*r) == 0)
+        error("Division by 0 is illegal", bc::RUNTIME_ERROR, line);
+      *l = op == bc::DIV_INT ? val::divide_int(*l, *r) : val::modulo(*l, *r);
+      break;
+  }
+}
+
+template <typename T>
+static bool compare_as(T l, T r, int op) {
+  switch (op) {
+    case bc::LT:
+      return l < r;
+    case bc::GT:
+      return l > r;
+    case bc::LEQ:
+      return l <= r;
+    case bc::GEQ:
+      return l >= r;
+    case bc::DNEQ:
+      return l != r;
+    default:
+      return l == r;
+  }
+}
+
+void VM::compare(val::Value *l, val::Value *r, int op, unsigned line) {
+  bool out = false;
+  if (!l->same_type(*r))
+    error("Incompatible types: " + l->type_name() + " and " + r->type_name(),
+          bc::RUNTIME_ERROR, line);
+  if (l->kind == val::STR) {
+    if (op != bc::IS)
+      error("cannot make this type of comparison on strings",
+            bc::RUNTIME_ERROR, line);
+    out = l->str() == r->str();
+  } else if (l->kind == val::INT && r->kind == val::INT) {
+    out = compare_as(l->i, r->i, op);
+  } else if (l->is_number()) {
+    out = compare_as(val::to_double(*l), val::to_double(*r), op);
+  } else {
+    error("cannot make this type of comparison on " + l->type_name(),
+          bc::RUNTIME_ERROR, line);
+  }
+  *l = val::Value((std::int64_t)out);
+  *r = val::Value();
+}
+
+// row-major address of the element, every key is checked against its
+// dimension
+std::size_t VM::compute_key(val::Value &arr, val::Value *keys, unsigned count,
+                            unsigned line) {
+  val::Array *a = val::as_array(arr);
+  std::size_t addr = 0;
+  long long key;
+  if (count != a->dims.size())
+    error("array has " + std::to_string(a->dims.size()) + " dimensions, " +
+              std::to_string(count) + " indices given",
+          bc::SEMANTIC_ERROR, line);
+  for (unsigned i = 0; i < count; ++i) {
+    if (!keys[i].is_number())
+      error("Only viable argument is a number", bc::SEMANTIC_ERROR, line);
+    key = val::to_int(keys[i]);
+    if (key < 0 || key >= a->dims[i])
+      error("index " + std::to_string(key) + " out of bounds",
+            bc::SEMANTIC_ERROR, line);
+    addr = addr * a->dims[i] + key;
+  }
+  return addr;
+}
+
+val::Value VM::declare_empty_array(val::Value *dims, unsigned count,
+                                   unsigned line) {
+  val::Array *arr = new val::Array;
+  val::Value out(val::ARR, arr);
+  std::size_t size = 1;
+  for (unsigned i = 0; i < count; ++i) {
+    if (!dims[i].is_number() || val::to_double(dims[i]) < 0)
+      error("Only viable argument is a number", bc::SEMANTIC_ERROR, line);
+    arr->dims.push_back(val::to_int(dims[i]));
+    size *= arr->dims.back();
+  }
+  arr->zeros(size);
+  return out;
+}
+
+val::Value VM::input(unsigned prompt, unsigned line) {
+  std::cout << program.strings[prompt];
+  std::string buffer;
+  std::cin >> buffer;
+  // a failed read is reported as the unexpected character it leaves behind
+  if (buffer.empty()) buffer.push_back('\0');
+  std::cout << std::endl;
+  lxr::Lexer lex(buffer);
+  tk::Token token;
+  if (!lex.get_next_token(token)) {
+    error(lex.get_error().message, bc::SEMANTIC_ERROR, line);
+  }
+  if (token.id == tk::NUM) return val::number(token);
+  return val::Value(token.val_str, token.id);
+}
+
+void VM::run() {
+  const bc::Chunk *chunk = &program.main;
+  const bc::Instr *ip = chunk->code.data();
+  val::Value *slots, *sp;
+  val::Value *l, *r;
+  std::size_t addr;
+  std::int64_t n;
+  int method;
+
+  reserve(chunk->locals.size() + chunk->max_stack + 1);
+  slots = stack.data();
+  sp = slots + chunk->locals.size();
+
+#define LINE (chunk->lines[ip - chunk->code.data() - 1])
+
+  for (;;) {
+    const bc::Instr &in = *ip++;
+    switch (in.op) {
+      case bc::CONST:
+        *sp++ = program.constants[in.a];
+        break;
+      case bc::LOAD:
+        if (slots[in.a].kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        *sp++ = slots[in.a];
+        break;
+      case bc::STORE:
+        slots[in.a] = std::move(*--sp);
+        break;
+      case bc::LOAD_ELEM:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (l->kind != val::ARR)
+          error(chunk->locals[in.a] + " is not an array", bc::SEMANTIC_ERROR,
+                LINE);
+        addr = compute_key(*l, sp - in.b, in.b, LINE);
+        sp -= in.b;
+        *sp++ = val::as_array(*l)->get(addr);
+        break;
+      case bc::STORE_ELEM:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (l->kind != val::ARR)
+          error(chunk->locals[in.a] + " is not an array", bc::SEMANTIC_ERROR,
+                LINE);
+        addr = compute_key(*l, sp - in.b, in.b, LINE);
+        sp -= in.b + 1;
+        l->detach();
+        val::as_array(*l)->set(addr, std::move(*sp));
+        break;
+      case bc::DISCARD:
+        *--sp = val::Value();
+        break;
+      // integers that do not overflow and plain doubles stay inline, anything
+      // else goes through arith()
+      case bc::ADD:
+        l = sp - 2, r = sp - 1;
+        if (l->kind == val::INT && r->kind == val::INT &&
+            !__builtin_add_overflow(l->i, r->i, &n))
+          l->i = n;
+        else if (l->kind == val::NUM && r->kind == val::NUM)
+          l->num += r->num;
+        else
+          arith(l, r, in.op, LINE);
+        --sp;
+        break;
+      case bc::SUB:
+        l = sp - 2, r = sp - 1;
+        if (l->kind == val::INT && r->kind == val::INT &&
+            !__builtin_sub_overflow(l->i, r->i, &n))
+          l->i = n;
+        else if (l->kind == val::NUM && r->kind == val::NUM)
+          l->num -= r->num;
+        else
+          arith(l, r, in.op, LINE);
+        --sp;
+        break;
+      case bc::MUL:
+        l = sp - 2, r = sp - 1;
+        if (l->kind == val::INT && r->kind == val::INT &&
+            !__builtin_mul_overflow(l->i, r->i, &n))
+          l->i = n;
+        else if (l->kind == val::NUM && r->kind == val::NUM)
+          l->num *= r->num;
+        else
+          arith(l, r, in.op, LINE);
+        --sp;
+        break;
+      case bc::DIV:
+      case bc::DIV_INT:
+      case bc::MOD:
+        arith(sp - 2, sp - 1, in.op, LINE);
+        --sp;
+        break;
+      case bc::NEG:
+        if (!sp[-1].is_number())
+          error("Cannot make negative value from " + sp[-1].type_name(),
+                bc::RUNTIME_ERROR, LINE);
+        sp[-1] = val::negate(sp[-1]);
+        break;
+      case bc::LT:
+      case bc::GT:
+      case bc::LEQ:
+      case bc::GEQ:
+      case bc::DNEQ:
+      case bc::IS:
+        l = sp - 2, r = sp - 1;
+        if (l->kind == val::INT && r->kind == val::INT)
+          l->i = compare_as(l->i, r->i, in.op);
+        else
+          compare(l, r, in.op, LINE);
+        --sp;
+        break;
+      case bc::JUMP:
+        ip = chunk->code.data() + in.a;
+        break;
+      case bc::JUMP_IF_FALSE:
+        if ((--sp)->i == 0) ip = chunk->code.data() + in.a;
+        break;
+      case bc::JUMP_IF_TRUE:
+        if ((--sp)->i != 0) ip = chunk->code.data() + in.a;
+        break;
+      case bc::FOR_INIT:
+        l = sp - 2, r = sp - 1;
+        if (!l->is_number() || !r->is_number())
+          error("Incompatible types: " + l->type_name() + " and " +
+                    r->type_name(),
+                bc::RUNTIME_ERROR, LINE);
+        slots[in.a] = val::Value(val::to_int(*l));
+        slots[in.a + 1] = val::Value(val::to_int(*r));
+        slots[in.a + 2] = val::Value(
+            (std::int64_t)(slots[in.a].i < slots[in.a + 1].i ? 1 : -1));
+        sp -= 2;
+        break;
+      case bc::FOR_ITER:
+        slots[in.b] = val::Value(slots[in.a].i);
+        break;
+      case bc::FOR_NEXT:
+        slots[in.a].i += slots[in.a + 2].i;
+        if (slots[in.a + 2].i > 0 ? slots[in.a].i <= slots[in.a + 1].i
+                                  : slots[in.a].i >= slots[in.a + 1].i)
+          ip = chunk->code.data() + in.b;
+        break;
+      case bc::DECLARE:
+        if (methods[program.methods[in.a].name_id] >= 0)
+          error("Duplicate method declaration", bc::SEMANTIC_ERROR, LINE);
+        methods[program.methods[in.a].name_id] = in.a;
+        break;
+      case bc::CALL: {
+        if ((method = methods[in.a]) < 0)
+          error("Undefined reference to method " + program.method_names[in.a],
+                bc::SEMANTIC_ERROR, LINE);
+        const bc::Chunk *callee = &program.methods[method];
+        DIAGNOSE(DEBUG, RUNTIME,
+                 "line " << LINE << ": calling " << callee->name);
+        if (callee->params > 0 && callee->params != (unsigned)in.b)
+          error("Incorrect number of arguments in the call of function " +
+                    callee->name,
+                bc::SEMANTIC_ERROR, LINE);
+        if (callee->params == 0) {
+          for (int i = 0; i < in.b; ++i) {
+            *--sp = val::Value();
+          }
+        }
+        frames.push_back({chunk, ip, (std::size_t)(slots - stack.data())});
+        std::size_t base = sp - stack.data() - callee->params;
+        reserve(base + callee->locals.size() + callee->max_stack + 1);
+        slots = stack.data() + base;
+        sp = slots + callee->locals.size();
+        for (l = slots + callee->params; l < sp; ++l) {
+          *l = val::Value();
+        }
+        chunk = callee;
+        ip = chunk->code.data();
+        break;
+      }
+      case bc::RETURN:
+      case bc::RETURN_VOID: {
+        val::Value out = in.op == bc::RETURN ? std::move(*--sp)
+                                             : val::Value(val::VOID);
+        while (sp > slots) {
+          *--sp = val::Value();
+        }
+        Frame &caller = frames.back();
+        chunk = caller.chunk;
+        ip = caller.ip;
+        slots = stack.data() + caller.base;
+        frames.pop_back();
+        *sp++ = std::move(out);
+        break;
+      }
+      case bc::NEW_ARR:
+        l = sp - in.a;
+        *l = declare_empty_array(l, in.a, LINE);
+        while (sp > l + 1) {
+          *--sp = val::Value();
+        }
+        break;
+      case bc::MAKE_ARR: {
+        val::Array *arr = new val::Array;
+        arr->dims = program.shapes[in.a];
+        arr->nums.reserve(in.b);
+        for (l = sp - in.b; l < sp; ++l) {
+          arr->push(std::move(*l));
+        }
+        sp -= in.b;
+        *sp++ = val::Value(val::ARR, arr);
+        break;
+      }
+      case bc::NEW_STACK:
+        *sp++ = val::Value(val::STACK, new val::Stack);
+        break;
+      case bc::NEW_QUEUE:
+        *sp++ = val::Value(val::QUEUE, new val::Queue);
+        break;
+      case bc::PUSH:
+      case bc::ENQUEUE:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (in.op == bc::PUSH && l->kind != val::STACK)
+          error("'push' can only be done on a stack", bc::SEMANTIC_ERROR, LINE);
+        if (in.op == bc::ENQUEUE && l->kind != val::QUEUE)
+          error("'enqueue' can only be done on a queue", bc::SEMANTIC_ERROR,
+                LINE);
+        --sp;
+        l->detach();
+        if (in.op == bc::PUSH)
+          val::as_stack(*l)->push(std::move(*sp));
+        else
+          val::as_queue(*l)->enqueue(std::move(*sp));
+        break;
+      case bc::POP:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (l->kind != val::STACK)
+          error("'pop' can only be performed on stacks", bc::SEMANTIC_ERROR,
+                LINE);
+        if (val::length(*l) == 0)
+          error("Cannot perform 'pop' on an empty stack", bc::SEMANTIC_ERROR,
+                LINE);
+        l->detach();
+        *sp++ = val::as_stack(*l)->pop();
+        break;
+      case bc::DEQUEUE:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (l->kind != val::QUEUE)
+          error("'dequeue' can only be performed on queues",
+                bc::SEMANTIC_ERROR, LINE);
+        if (val::length(*l) == 0)
+          error("Cannot perform 'pop' on an empty stack", bc::SEMANTIC_ERROR,
+                LINE);
+        l->detach();
+        *sp++ = val::as_queue(*l)->dequeue();
+        break;
+      case bc::GET_NEXT:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (!l->is_container() || val::length(*l) == 0)
+          error("cannot perform 'getNext()' on an empty container",
+                bc::SEMANTIC_ERROR, LINE);
+        if (l->kind == val::ARR)
+          error("'getNext()' can only be perfromed on a stack or a queue",
+                bc::SEMANTIC_ERROR, LINE);
+        if (l->kind == val::STACK)
+          *sp++ = val::as_stack(*l)->next();
+        else
+          *sp++ = val::as_queue(*l)->next();
+        break;
+      case bc::LENGTH:
+      case bc::HAS_NEXT:
+      case bc::IS_EMPTY:
+        l = &slots[in.a];
+        if (l->kind == val::UNDEFINED) error_uref(chunk, in.a, LINE);
+        if (in.op == bc::LENGTH)
+          *sp++ = val::Value(val::length(*l));
+        else if (in.op == bc::HAS_NEXT)
+          *sp++ = val::Value((std::int64_t)(l->is_container() &&
+                                            val::length(*l) > 0));
+        else
+          *sp++ = val::Value((std::int64_t)(!l->is_container() ||
+                                            val::length(*l) == 0));
+        break;
+      case bc::PRINT:
+        sp[-1].print();
+        *--sp = val::Value();
+        break;
+      case bc::PRINT_NL:
+        std::cout << '\n';
+        break;
+      case bc::INPUT:
+        *sp++ = input(in.a, LINE);
+        break;
+      case bc::ERROR:
+        error(program.strings[in.a], in.b, LINE);
+        break;
+      case bc::HALT:
+        while (sp > slots) {
+          *--sp = val::Value();
+        }
+        std::cout << std::flush;
+        return;
+    }
+  }
+
+#undef LINE
+}
+
+}  // namespace IBPCI
@@ -3,23 +3,88 @@
 
 #include <activation_record.hpp>
 #include <ast.hpp>
+#include <ast_image.hpp>
+#include <closure.hpp>
+#include <compiler.hpp>
+#include <cstdio>
+#include <diagnostics.hpp>
+#include <emitter.hpp>
 #include <fstream>
 #include <iostream>
 #include <lexer.hpp>
+#include <optimizer.hpp>
 #include <parser.hpp>
+#include <resolver.hpp>
 #include <runtime.hpp>
 #include <string>
+#include <string_view>
+#include <typer.hpp>
+#include <vm.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 void throw_error(unsigned type, unsigned line_number, std::string message);
-void interpret(char *filename, unsigned mode);
+void interpret(char *filename, unsigned mode, unsigned engine, bool cache,
+               bool lazy, const opt::Options &options);
+std::string image_path(const std::string &filename);
+ast::Tree *parse(std::string_view source, const std::string &image);
+
+// The text of a program. Regular files are mapped read-only, pipes and stdin
+// (the filename "-") are read into a buffer.
+class SourceFile {
+ private:
+  std::string buffer;
+  void *mapping{nullptr};
+  std::size_t mapped{0};
+
+  bool map(int fd);
+  void read(int fd);
+  void read(std::istream &in);
 
-std::string get_buffer(char *filename);
-void run_lexer(std::string buffer);
-void run_parser(std::string buffer);
-void run_interpreter(std::string buffer, bool logging);
+ public:
+  SourceFile(const char *filename);
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+  ~SourceFile();
+  std::string_view text() const;
+};
+
+bool check(ast::Tree &tree, rsv::Resolver &resolver, bool specialize,
+           const opt::Options &options);
+void optimize(ast::Tree &tree, rsv::scopes &scopes,
+              const opt::Options &options);
+void run_lexer(std::string_view source);
+void run_parser(ast::Tree *tree, const opt::Options &options);
+void run_interpreter(ast::Tree *tree, bool logging,
+                     const opt::Options &options);
+void run_compiler(ast::Tree *tree, const opt::Options &options);
+void run_vm(ast::Tree *tree, const opt::Options &options);
+void run_closures(ast::Tree *tree, const opt::Options &options);
+void run_emitter(ast::Tree *tree, const opt::Options &options);
+void run_lazy(std::string_view source, bool logging,
+              const opt::Options &options);
+void run_stream(char *filename);
 
 enum err_type { LEXICAL_ERROR, PARSE_ERROR, RUN_TIME_ERROR, FILE_NOT_FOUND };
 
-enum run_mode { INTERPRET, PRINT_TOKENS, PRINT_AST, PRINT_CALL_STACK };
+enum run_mode {
+  INTERPRET,
+  PRINT_TOKENS,
+  PRINT_AST,
+  PRINT_CALL_STACK,
+  PRINT_BYTECODE,
+  STREAM,
+  EMIT_CPP
+};
+
+enum engine_type { AST_ENGINE, VM_ENGINE, CLOSURE_ENGINE };
+
+// bytes the streaming lexer reads at a time
+const std::size_t STREAM_CHUNK = 1 << 16;
 
 #endif
@@ -23,82 +23,343 @@ void throw_error(unsigned type, unsigned line_number, std::string message) {
   exit(1);
 }
 
-std::string get_buffer(char *filename) {
-  char c;
-  std::string buffer;
-  std::fstream file(filename);
-
+SourceFile::SourceFile(const char *filename) {
+  bool from_stdin = !std::string(filename).compare("-");
+#ifndef _WIN32
+  int fd = from_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+  if (fd < 0) {
+    throw_error(FILE_NOT_FOUND, 0,
+                "File \'" + std::string(filename) + "\' does not exist");
+  }
+  // stdin is read even when it is a file, input() goes on reading after it
+  if (from_stdin || !map(fd)) read(fd);
+  if (!from_stdin) close(fd);
+#else
+  if (from_stdin) {
+    read(std::cin);
+    return;
+  }
+  std::ifstream file(filename, std::ios::binary);
   if (!file.good()) {
     throw_error(FILE_NOT_FOUND, 0,
                 "File \'" + std::string(filename) + "\' does not exist");
   }
+  read(file);
+#endif
+}
+
+SourceFile::~SourceFile() {
+#ifndef _WIN32
+  if (mapping != nullptr) munmap(mapping, mapped);
+#endif
+}
+
+// only regular files can be mapped, an empty one is left as an empty buffer
+bool SourceFile::map(int fd) {
+#ifndef _WIN32
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) return false;
+  if (info.st_size == 0) return true;
+  void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (address == MAP_FAILED) return false;
+  madvise(address, info.st_size, MADV_SEQUENTIAL);
+  mapping = address;
+  mapped = info.st_size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SourceFile::read(int fd) {
+#ifndef _WIN32
+  char chunk[1 << 16];
+  ssize_t count;
+  while ((count = ::read(fd, chunk, sizeof(chunk))) > 0) {
+    buffer.append(chunk, count);
+  }
+#endif
+}
 
-  while (!file.eof()) {
-    file.get(c);
-    buffer += c;
+void SourceFile::read(std::istream &in) {
+  char chunk[1 << 16];
+  while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+    buffer.append(chunk, in.gcount());
   }
+}
 
-  file.close();
+std::string_view SourceFile::text() const {
+  if (mapping != nullptr)
+    return std::string_view(static_cast<const char *>(mapping), mapped);
   return buffer;
 }
 
-void interpret(char *filename, unsigned mode) {
-  std::string buffer = get_buffer(filename);
+void interpret(char *filename, unsigned mode, unsigned engine, bool cache,
+               bool lazy, const opt::Options &options) {
+  if (mode == STREAM) {
+    run_stream(filename);
+    return;
+  }
+  SourceFile file(filename);
+  std::string_view source = file.text();
+  if (mode == PRINT_TOKENS) {
+    run_lexer(source);
+    return;
+  }
+  // only the tree walker can take the bodies of methods as they are called
+  if (lazy && (mode == PRINT_CALL_STACK ||
+               (mode == INTERPRET && engine == AST_ENGINE))) {
+    run_lazy(source, mode == PRINT_CALL_STACK, options);
+    return;
+  }
+  // stdin has no name to put an image next to
+  bool cached = cache && std::string(filename).compare("-");
+  ast::Tree *tree = parse(source, cached ? image_path(filename) : "");
+  // nothing was translated, whatever did get printed is the error
+  if (tree == nullptr && mode == EMIT_CPP) exit(1);
+  if (tree == nullptr) return;
 
   switch (mode) {
     case INTERPRET: {
-      run_interpreter(buffer, false);
-      break;
-    }
-    case PRINT_TOKENS: {
-      run_lexer(buffer);
+      if (engine == VM_ENGINE)
+        run_vm(tree, options);
+      else if (engine == CLOSURE_ENGINE)
+        run_closures(tree, options);
+      else
+        run_interpreter(tree, false, options);
       break;
     }
     case PRINT_AST: {
-      run_parser(buffer);
+      run_parser(tree, options);
       break;
     }
     case PRINT_CALL_STACK: {
-      run_interpreter(buffer, true);
+      run_interpreter(tree, true, options);
+      break;
+    }
+    case PRINT_BYTECODE: {
+      run_compiler(tree, options);
+      break;
+    }
+    case EMIT_CPP: {
+      run_emitter(tree, options);
       break;
     }
   }
 }
 
-void run_lexer(std::string buffer) {
-  lxr::Lexer lex(buffer);
-  tk::Token token;
-  if (!lex.get_next_token(token)) {
-    std::cout << lex.get_error().message;
-    return;
+// prog.ib has its image in prog.ibc, any other name gets .ibc appended
+std::string image_path(const std::string &filename) {
+  std::size_t size = filename.size();
+  if (size > 3 && !filename.compare(size - 3, 3, ".ib")) return filename + "c";
+  return filename + ".ibc";
+}
+
+// The tree of the program. With an image path the tree is read from the
+// image there when it is an image of this very source; otherwise the source
+// is parsed and the image is written for the next run. A failed write only
+// costs the next run a parse. Prints the error and returns nullptr when the
+// program does not parse.
+ast::Tree *parse(std::string_view source, const std::string &image) {
+  std::uint64_t hash = 0;
+  if (!image.empty()) {
+    hash = ast::hash_bytes(source);
+    if (std::ifstream(image).good()) {
+      SourceFile file(image.c_str());
+      ast::Tree *tree = ast::read_image(file.text(), hash);
+      if (tree != nullptr) return tree;
+    }
   }
-  while (token.id != tk::END_FILE) {
-    std::cout << "line " << lex.line_num << ": ";
-    tk::print_token(&token);
-    if (!lex.get_next_token(token)) {
-      std::cout << lex.get_error().message;
+  prs::Parser parser(source);
+  ast::Tree *tree = parser.parse();
+  if (tree == nullptr) {
+    std::cout << parser.get_error().message;
+    return nullptr;
+  }
+  if (!image.empty()) {
+    // written aside and renamed, a run reading the image never sees half of
+    // it
+    std::string written = image + ".tmp";
+    std::ofstream out(written, std::ios::binary | std::ios::trunc);
+    std::string bytes = ast::write_image(*tree, hash);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if (out)
+      std::rename(written.c_str(), image.c_str());
+    else
+      std::remove(written.c_str());
+  }
+  return tree;
+}
+
+void run_lexer(std::string_view source) {
+  lxr::Lexer lex(source);
+  lxr::Tokens tokens;
+  lex.tokenize(tokens);
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    if (tokens.failed && i + 1 == tokens.size()) {
+      std::cout << tokens.error.message;
       return;
     }
+    if (tokens.ids[i] == tk::END_FILE) return;
+    std::cout << "line " << tokens.lines[i] << ": <"
+              << tk::id_to_str(tokens.ids[i]) << ",";
+    if (tokens.ids[i] == tk::NUM)
+      std::cout << tokens.values[i];
+    else
+      std::cout << lex.lexeme(tokens.span(i));
+    std::cout << ">" << std::endl;
   }
 }
 
-void run_parser(std::string buffer) {
-  prs::Parser parser(buffer);
-  ast::AST *root = parser.parse();
-  if (root == nullptr) {
-    std::cout << parser.get_error().message;
+// Resolves the program, or prints the error that keeps it from running, then
+// optimizes it. Only the tree walker runs the nodes specialize makes.
+bool check(ast::Tree &tree, rsv::Resolver &resolver, bool specialize,
+           const opt::Options &options) {
+  if (!resolver.resolve()) {
+    std::cout << resolver.get_error().message << std::endl;
+    return false;
+  }
+  if (specialize) ty::Typer(tree, resolver.get_scopes()).specialize();
+  optimize(tree, resolver.get_scopes(), options);
+  return true;
+}
+
+// the statistics go to stderr, next to the output of the program
+void optimize(ast::Tree &tree, rsv::scopes &scopes,
+              const opt::Options &options) {
+  opt::PassManager passes(tree, scopes, options.level);
+  passes.run();
+  if (options.stats) passes.print_stats(std::cerr);
+}
+
+// the tree the engines run, which is only resolved when it is optimized
+void run_parser(ast::Tree *tree, const opt::Options &options) {
+  rsv::Resolver resolver(*tree);
+  if (options.level > 0 && !check(*tree, resolver, false, options)) {
+    delete tree;
+    return;
+  }
+  ast::print_tree(*tree, tree->root, 0);
+  delete tree;
+}
+
+void run_interpreter(ast::Tree *tree, bool logging,
+                     const opt::Options &options) {
+  rsv::Resolver resolver(*tree);
+  if (!check(*tree, resolver, true, options)) {
+    delete tree;
+    return;
+  }
+  IBPCI::Interpreter ibpci(*tree, resolver.get_scopes(), logging);
+  ibpci.interpret();
+  delete tree;
+}
+
+void run_compiler(ast::Tree *tree, const opt::Options &options) {
+  rsv::Resolver resolver(*tree);
+  if (!check(*tree, resolver, false, options)) {
+    delete tree;
+    return;
+  }
+  bc::Program program = bc::Compiler(*tree, resolver.get_scopes()).compile();
+  delete tree;
+  bc::print_program(program);
+}
+
+void run_vm(ast::Tree *tree, const opt::Options &options) {
+  rsv::Resolver resolver(*tree);
+  if (!check(*tree, resolver, false, options)) {
+    delete tree;
+    return;
+  }
+  bc::Program program = bc::Compiler(*tree, resolver.get_scopes()).compile();
+  delete tree;
+  IBPCI::VM vm(program);
+  vm.run();
+}
+
+void run_closures(ast::Tree *tree, const opt::Options &options) {
+  rsv::Resolver resolver(*tree);
+  if (!check(*tree, resolver, false, options)) {
+    delete tree;
+    return;
+  }
+  IBPCI::ClosureEngine engine(*tree, resolver.get_scopes());
+  engine.run();
+  delete tree;
+}
+
+// Prints the program as a C++ translation unit, or the error that kept it from
+// being translated with a failing exit status.
+void run_emitter(ast::Tree *tree, const opt::Options &options) {
+  rsv::Resolver resolver(*tree);
+  if (!check(*tree, resolver, false, options)) {
+    delete tree;
+    exit(1);
   }
-  ast::print_tree(root, 0);
-  ast::delete_tree(root);
+  std::cout << IBPCI::CppEmitter(*tree, resolver.get_scopes()).emit();
+  delete tree;
 }
 
-void run_interpreter(std::string buffer, bool logging) {
-  prs::Parser parser(buffer);
-  ast::AST *root = parser.parse();
-  if (!root) {
+// Runs the program on the tree walker with the bodies of methods parsed and
+// resolved on their first call, methods that are never called cost no more
+// than finding where they end. Errors in a body only show up once it is
+// called.
+void run_lazy(std::string_view source, bool logging,
+              const opt::Options &options) {
+  prs::Parser parser(source);
+  parser.defer_bodies();
+  ast::Tree *tree = parser.parse();
+  if (tree == nullptr) {
     std::cout << parser.get_error().message;
     return;
   }
-  IBPCI::Interpreter ibpci(root, logging);
+  rsv::Resolver resolver(*tree);
+  if (!resolver.resolve()) {
+    std::cout << resolver.get_error().message << std::endl;
+    delete tree;
+    return;
+  }
+  ty::Typer typer(*tree, resolver.get_scopes());
+  typer.specialize();
+  optimize(*tree, resolver.get_scopes(), options);
+  IBPCI::Interpreter ibpci(*tree, resolver.get_scopes(), logging);
+  ibpci.parse_lazily(parser, resolver, typer);
   ibpci.interpret();
+  delete tree;
+}
+
+// Runs the program on the tree walker while it is read from the file: every
+// statement of main is executed as soon as it is parsed and dropped after,
+// only method declarations stay in the tree. Errors show up when the
+// statement that has them is reached.
+void run_stream(char *filename) {
+  std::ifstream file;
+  std::istream *in = &std::cin;
+  if (std::string(filename).compare("-")) {
+    file.open(filename, std::ios::binary);
+    if (!file.good()) {
+      throw_error(FILE_NOT_FOUND, 0,
+                  "File \'" + std::string(filename) + "\' does not exist");
+    }
+    in = &file;
+  }
+  prs::Parser parser(*in, STREAM_CHUNK);
+  ast::Tree *tree = parser.start();
+  rsv::Resolver resolver(*tree);
+  resolver.start();
+  IBPCI::Interpreter ibpci(*tree, resolver.get_scopes(), false);
+  ast::node stmt;
+  while ((stmt = parser.next_stmt()) != ast::NONE) {
+    if (!resolver.resolve(stmt)) {
+      std::cout << resolver.get_error().message << std::endl;
+      delete tree;
+      return;
+    }
+    ibpci.interpret(stmt);
+    if ((*tree)[stmt].id != ast::METHOD) parser.forget_stmt();
+  }
+  if (parser.failed()) std::cout << parser.get_error().message;
+  delete tree;
 }
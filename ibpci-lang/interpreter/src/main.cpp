@@ -4,12 +4,40 @@
 
 void print_help() {
   std::cout << "Welcome to ibpci - the IB pseudocode interpreter" << std::endl
-            << "Basic usage: ibpci <filepath>" << std::endl
+            << "Basic usage: ibpci <filepath>, - reads the program from stdin"
+            << std::endl
             << "Additional flags: " << std::endl
             << " * -p : see abstract syntax tree of your code" << std::endl
             << " * -l : see tokens your code consists of" << std::endl
+            << " * -b : see bytecode your code compiles to" << std::endl
             << " * -s : log call stack of your program (best to pipe to less)"
+            << std::endl
+            << " * --engine=vm : run your code on the bytecode virtual machine"
+            << std::endl
+            << " * --engine=closure : run your code on closures built from"
+            << " the syntax tree before it runs" << std::endl
+            << " * --stream : run your code statement by statement while it is"
+            << " read" << std::endl
+            << " * --cache : keep the parsed program in an image next to it"
+            << " (prog.ib -> prog.ibc) and start from that image while the"
+            << " program is unchanged" << std::endl
+            << " * --emit-cpp : print your code translated to C++, build it"
+            << " with the ibpci/include directory on the include path"
+            << std::endl
+            << " * --lazy : parse the body of a method when it is first called"
+            << " (tree-walking interpreter only)" << std::endl
+            << " * -O0, -O1, -O2 : optimize the syntax tree before it runs, -O1"
+            << " folds constants and drops code that never runs, -O2 also"
+            << " propagates variables assigned once and moves what a loop"
+            << " computes the same way every time out of it (default -O0,"
+            << " --stream is never optimized)" << std::endl
+            << " * --opt-stats : print what every optimization pass changed on"
+            << " stderr" << std::endl;
+#ifdef IBPCI_DIAGNOSTICS
+  std::cout << " * --log=<categories>[:<level>] : trace lexer, parser, runtime"
+            << " or all of them on stderr, at trace, debug (default) or info"
             << std::endl;
+#endif
   exit(1);
 }
 
@@ -20,21 +48,65 @@ int flag_to_runmode(std::string flag) {
     return PRINT_TOKENS;
   } else if (!flag.compare("-s")) {
     return PRINT_CALL_STACK;
+  } else if (!flag.compare("-b")) {
+    return PRINT_BYTECODE;
+  } else if (!flag.compare("--stream")) {
+    return STREAM;
+  } else if (!flag.compare("--emit-cpp")) {
+    return EMIT_CPP;
   }
   return -1;
 }
 
-int main(int argc, char **argv) {
-  int flag;
-  if (argc == 3 && (flag = flag_to_runmode(argv[1])) > 0) {
-    interpret(argv[2], flag);
-  } else {
-    interpret(argv[1], INTERPRET);
+int flag_to_engine(std::string flag) {
+  if (!flag.compare("--engine=ast")) {
+    return AST_ENGINE;
+  } else if (!flag.compare("--engine=vm")) {
+    return VM_ENGINE;
+  } else if (!flag.compare("--engine=closure")) {
+    return CLOSURE_ENGINE;
   }
+  return -1;
+}
 
-  // run_parser(get_buffer(argv[1]));
+int main(int argc, char **argv) {
+  int flag, mode = INTERPRET, engine = AST_ENGINE;
+  bool cache = false, lazy = false;
+  opt::Options options;
+  char *filename = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if ((flag = flag_to_runmode(argv[i])) > 0) {
+      mode = flag;
+    } else if ((flag = flag_to_engine(argv[i])) >= 0) {
+      engine = flag;
+    } else if (!std::string(argv[i]).compare("--cache")) {
+      cache = true;
+    } else if (!std::string(argv[i]).compare("--lazy")) {
+      lazy = true;
+    } else if (!std::string(argv[i]).compare("-O0") ||
+               !std::string(argv[i]).compare("-O1") ||
+               !std::string(argv[i]).compare("-O2")) {
+      options.level = argv[i][2] - '0';
+    } else if (!std::string(argv[i]).compare(0, 2, "-O")) {
+      // any other -O is an unknown level, not a file name
+      print_help();
+    } else if (!std::string(argv[i]).compare("--opt-stats")) {
+      options.stats = true;
+    } else if (!std::string(argv[i]).compare(0, 6, "--log=")) {
+#ifdef IBPCI_DIAGNOSTICS
+      if (!dg::configure(argv[i] + 6)) print_help();
+#else
+      std::cerr << "diagnostics are compiled out of release builds"
+                << std::endl;
+#endif
+    } else {
+      filename = argv[i];
+    }
+  }
 
-  if (argc == 1) {
+  if (filename == nullptr) {
     print_help();
   }
+
+  interpret(filename, mode, engine, cache, lazy, options);
 }
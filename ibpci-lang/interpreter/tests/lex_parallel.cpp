@@ -0,0 +1,54 @@
+// Lexes every file given, repeated until it is long enough to be split into
+// chunks, on 1 to MAX_THREADS threads and compares the tokens and the error
+// with what the lexer gives on one thread
+// usage: lex_parallel <files>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "lexer.hpp"
+
+const unsigned MAX_THREADS = 4;
+
+std::string read_repeated(const char *path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  std::string text = buffer.str();
+  if (text.empty() || text.back() != '\n') text.push_back('\n');
+  std::string out;
+  while (out.size() < lxr::PARALLEL_MIN) out += text;
+  return out;
+}
+
+bool same_tokens(const lxr::Tokens &a, const lxr::Tokens &b) {
+  if (a.failed != b.failed) return false;
+  if (a.failed && (a.error.message != b.error.message ||
+                   a.error.line_num != b.error.line_num))
+    return false;
+  return a.ids == b.ids && a.num_types == b.num_types &&
+         a.offsets == b.offsets && a.lengths == b.lengths &&
+         a.lines == b.lines && a.values == b.values;
+}
+
+int main(int argc, char **argv) {
+  int status = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::string source = read_repeated(argv[i]);
+    lxr::Tokens serial;
+    lxr::Lexer(source).tokenize(serial, 1);
+    for (unsigned threads = 2; threads <= MAX_THREADS; ++threads) {
+      lxr::Tokens parallel;
+      lxr::Lexer(source).tokenize(parallel, threads);
+      if (same_tokens(serial, parallel)) {
+        std::cout << "ok   " << threads << " threads " << argv[i] << std::endl;
+      } else {
+        std::cout << "FAIL " << threads << " threads " << argv[i] << std::endl;
+        status = 1;
+      }
+    }
+  }
+  return status;
+}
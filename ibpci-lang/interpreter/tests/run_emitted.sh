@@ -0,0 +1,42 @@
+#!/bin/bash
+# Translates every example to C++ with --emit-cpp, builds and runs it, and
+# compares the output with the output of the tree-walking interpreter; an
+# example that does not translate is compared by the error printed instead
+# usage: run_emitted.sh [path to interpreter] [C++ compiler]
+
+INTERPRETER=${1:-./interpreter}
+COMPILER=${2:-c++}
+EXAMPLES=$(dirname "$0")/../../examples/tests
+RUNTIME=$(dirname "$0")/../../ibpci/include
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+status=0
+
+for file in "$EXAMPLES"/*.ib "$EXAMPLES"/error_demos/*.ib; do
+  case $(basename "$file") in
+    fizzbuzz.ib) input='15' ;;
+    data_types_demo.ib) input='"IB" 6 7' ;;
+    *) input='' ;;
+  esac
+  expected=$(echo "$input" | "$INTERPRETER" "$file" 2>/dev/null)
+  if "$INTERPRETER" --emit-cpp "$file" >"$BUILD/program.cpp" 2>/dev/null; then
+    if ! "$COMPILER" -std=c++17 -O1 -I"$RUNTIME" "$BUILD/program.cpp" \
+      -o "$BUILD/program"; then
+      echo "FAIL (build) $file"
+      status=1
+      continue
+    fi
+    actual=$(echo "$input" | "$BUILD/program" 2>/dev/null)
+  else
+    actual=$(cat "$BUILD/program.cpp")
+  fi
+  if [ "$expected" == "$actual" ]; then
+    echo "ok   --emit-cpp $file"
+  else
+    echo "FAIL --emit-cpp $file"
+    diff <(echo "$expected") <(echo "$actual")
+    status=1
+  fi
+done
+
+exit $status
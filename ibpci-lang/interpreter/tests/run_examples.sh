@@ -0,0 +1,84 @@
+#!/bin/bash
+# Runs every example on each execution engine, at each optimization level
+# and with method bodies parsed lazily, and the examples without errors in
+# streaming mode, and compares the output with the output of the unoptimized
+# tree-walking interpreter. Every example is also run twice from a copy with
+# --cache, once writing its image and once starting from it. The output of an
+# error demo has to be the one next to it (name.ib -> name.out).
+# usage: run_examples.sh [path to interpreter]
+
+INTERPRETER=${1:-./interpreter}
+EXAMPLES=$(dirname "$0")/../../examples/tests
+FLAGS="--engine=vm --engine=closure -O1 -O2"
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+status=0
+
+# check <what> <expected> <actual>
+check() {
+  if [ "$2" == "$3" ]; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1"
+    diff <(echo "$2") <(echo "$3")
+    status=1
+  fi
+}
+
+for file in "$EXAMPLES"/*.ib "$EXAMPLES"/error_demos/*.ib; do
+  case $(basename "$file") in
+    fizzbuzz.ib) input='15' ;;
+    data_types_demo.ib) input='"IB" 6 7' ;;
+    *) input='' ;;
+  esac
+  expected=$(echo "$input" | "$INTERPRETER" "$file" 2>/dev/null)
+  case $file in
+    */error_demos/*) check "error of $file" "$(cat "${file%.ib}.out")" \
+      "$expected" ;;
+  esac
+  flags=$FLAGS
+  case $file in
+    */error_demos/*) flags="$flags --lazy" ;;
+    *) flags="$flags --lazy --stream" ;;
+  esac
+  for flag in $flags; do
+    actual=$(echo "$input" | "$INTERPRETER" $flag "$file" 2>/dev/null)
+    check "$flag $file" "$expected" "$actual"
+  done
+  cp "$file" "$WORK/program.ib"
+  rm -f "$WORK/program.ibc"
+  for run in cold warm; do
+    actual=$(echo "$input" | "$INTERPRETER" --cache "$WORK/program.ib" \
+      2>/dev/null)
+    check "--cache ($run) $file" "$expected" "$actual"
+  done
+done
+
+# an image of a program edited after the image was written is ignored, the
+# edit keeps the size of the program
+cp "$EXAMPLES/sum_triangle.ib" "$WORK/stale.ib"
+"$INTERPRETER" --cache "$WORK/stale.ib" >/dev/null 2>&1
+written=$([ -f "$WORK/stale.ibc" ] && echo yes)
+check "--cache writes stale.ibc" yes "$written"
+sed -i 's/\[1,2,3,4,5\]/[5,4,3,2,1]/' "$WORK/stale.ib"
+expected=$("$INTERPRETER" "$WORK/stale.ib" 2>/dev/null)
+actual=$("$INTERPRETER" --cache "$WORK/stale.ib" 2>/dev/null)
+check "--cache (stale image) sum_triangle.ib" "$expected" "$actual"
+
+# --lazy does not parse a method that is never called, its syntax error only
+# shows once the method is called
+cat >"$WORK/lazy.ib" <<'PROGRAM'
+method broken(X)
+    return X +
+end method
+
+output("before")
+PROGRAM
+actual=$("$INTERPRETER" --lazy "$WORK/lazy.ib" 2>/dev/null)
+check "--lazy (never called) lazy.ib" "before" "$actual"
+echo 'output(broken(1))' >>"$WORK/lazy.ib"
+expected=$(echo before; "$INTERPRETER" "$WORK/lazy.ib" 2>/dev/null)
+actual=$("$INTERPRETER" --lazy "$WORK/lazy.ib" 2>/dev/null)
+check "--lazy (called) lazy.ib" "$expected" "$actual"
+
+exit $status